@@ -360,6 +360,42 @@ SRST
     Show host USB devices.
 ERST
 
+#if defined(TARGET_I386)
+    {
+        .name       = "mesapt-profile",
+        .args_type  = "reset:-r",
+        .params     = "[-r]",
+        .help       = "show MesaGL pass-through per-function profile "
+                      "(-r: reset counters afterwards)",
+    },
+#endif
+
+SRST
+  ``info mesapt-profile [-r]``
+    Show MesaGL pass-through call counts, host driver time and FIFO
+    bytes per GL function, and batches per doorbell. Requires
+    ``FuncProfile,1`` in mesagl.cfg. With ``-r``, reset the counters
+    after reporting.
+ERST
+
+#if defined(TARGET_I386)
+    {
+        .name       = "glidept-profile",
+        .args_type  = "reset:-r",
+        .params     = "[-r]",
+        .help       = "show Glide pass-through frame-time and per-function profile "
+                      "(-r: reset counters afterwards)",
+    },
+#endif
+
+SRST
+  ``info glidept-profile [-r]``
+    Show Glide pass-through frame-time percentiles, call counts and host
+    time per Glide function, and LFB MMIO exit counts. Requires
+    ``FuncProfile,1`` in glide.cfg. With ``-r``, reset the counters
+    after reporting.
+ERST
+
     {
         .name       = "capture",
         .args_type  = "",
@@ -19,6 +19,7 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/timer.h"
 #include "hw/hw.h"
 
 #include "glide2x_impl.h"
@@ -42,6 +43,8 @@
 struct tblFuncs {
     const char *sym;
     int impl;
+    int nargs;
+    int nfifo;
     void *ptr;
 };
 
@@ -252,7 +255,7 @@ static int getNumArgs(const char *sym)
     return (atoi(++p) >> 2);
 }
 
-int GRFEnumArgsCnt(int FEnum)
+static int getFifoArgs(int FEnum)
 {
     int val = getNumArgs(tblGlide2x[FEnum].sym);
 
@@ -269,6 +272,11 @@ int GRFEnumArgsCnt(int FEnum)
     return val;
 }
 
+int GRFEnumArgsCnt(int FEnum)
+{
+    return tblGlide2x[FEnum].nfifo;
+}
+
 uint32_t texTableValid(uint32_t format) {
     switch (format) {
         case GR_TEXFMT_YIQ_422:
@@ -309,6 +317,18 @@ const char *wrGetString(uint32_t a0)
     return (*fpra0)(a0);
 }
 
+uint32_t wrTexCalcMem(uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    uint32_t __stdcall (*fpra3)(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+    fpra3 = tblGlide2x[FEnum_grTexCalcMemRequired].ptr;
+    return (fpra3)? (*fpra3)(a0, a1, a2, a3):0;
+}
+
+const char *GRFEnumFuncSym(const int FEnum)
+{
+    return tblGlide2x[FEnum].sym;
+}
+
 const char *getGRFuncStr(int FEnum)
 {
     if (tblGlide2x[FEnum].impl == 0) {
@@ -321,7 +341,8 @@ const char *getGRFuncStr(int FEnum)
 void doGlideFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret, int emu211)
 {
     static int glidePostInit = 0;
-    int numArgs = getNumArgs(tblGlide2x[FEnum].sym);
+    int numArgs = tblGlide2x[FEnum].nargs;
+    int64_t t0 = (GRProfileActive())? get_clock():0;
 
     if (GRFuncTrace()) {
         const char *fstr = getGRFuncStr(FEnum);
@@ -375,6 +396,15 @@ void doGlideFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret, int
             break;
     }
 
+    if (TexCacheHit(FEnum, arg, parg)) {
+        /* Glide3 grTexDownloadMipMapLevelPartial returns FxBool, the
+         * skipped downloads are void otherwise */
+        *ret = (FEnum == FEnum_grTexDownloadMipMapLevelPartial)? 1:0;
+        if (t0)
+            GRProfileFunc(FEnum, get_clock() - t0);
+        return;
+    }
+
     typedef union {
     uint32_t __stdcall (*fprp0)(uintptr_t arg0);
     uint32_t __stdcall (*fprp1)(uintptr_t arg0, uintptr_t arg1);
@@ -767,6 +797,8 @@ void doGlideFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret, int
 
     /* End - generated by hostgenfuncs */
 
+    if (t0)
+        GRProfileFunc(FEnum, get_clock() - t0);
 }
 
 #ifdef CONFIG_WIN32
@@ -900,6 +932,8 @@ int init_glide2x(const char *dllname)
     }
 
     for (i = 0; i < FEnum_zzG2xFuncEnum_max; i++) {
+        tblGlide2x[i].nargs = getNumArgs(tblGlide2x[i].sym);
+        tblGlide2x[i].nfifo = getFifoArgs(i);
 #ifdef CONFIG_WIN32
         tblGlide2x[i].ptr = (void *)(GetProcAddress(hDll, tblGlide2x[i].sym));
 #endif
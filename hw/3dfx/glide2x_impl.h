@@ -24,6 +24,8 @@
 #include <stdint.h>
 
 #include "glidewnd.h"
+#include "glideprof.h"
+#include "gltexcache.h"
 #include "g2xfuncs.h"
 #include "szgrdata.h"
 
@@ -125,7 +127,9 @@ uint32_t wrReadRegion(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3
 uint32_t wrWriteRegion(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t arg5, uint32_t arg6, uintptr_t arg7);
 uintptr_t wrGetProcAddress(uintptr_t);
 const char *wrGetString(uint32_t);
+uint32_t wrTexCalcMem(uint32_t, uint32_t, uint32_t, uint32_t);
 const char *getGRFuncStr(int);
+const char *GRFEnumFuncSym(const int);
 
 #ifndef CONSOLE_H
 void glide_renderer_stat(const int);
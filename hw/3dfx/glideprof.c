@@ -0,0 +1,286 @@
+/*
+ * QEMU 3Dfx Glide Pass-Through
+ *
+ *  Copyright (c) 2018-2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/atomic.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "qapi/type-helpers.h"
+#include "qapi/qapi-commands-machine-target.h"
+#include "qapi/qmp/qdict.h"
+#include "monitor/monitor.h"
+
+#include "glide2x_impl.h"
+
+#define DEBUG_GLIDEPROF
+
+#ifdef DEBUG_GLIDEPROF
+#define DPRINTF(fmt, ...) \
+    do { fprintf(stderr, "glidept: " fmt "\n" , ## __VA_ARGS__); } while(0)
+#else
+#define DPRINTF(fmt, ...)
+#endif
+
+/* Frame-time histogram, 100 us buckets up to 250 ms plus overflow */
+#define FRAME_HIST_US   100
+#define FRAME_HIST_MAX  2500
+
+typedef struct {
+    uint64_t calls;
+    uint64_t ns;
+} PROFENTRY;
+
+typedef struct {
+    uint32_t bucket[FRAME_HIST_MAX + 1];
+    uint64_t frames;
+    uint64_t ns;
+    uint64_t max;
+} FRAMEHIST;
+
+/*
+ * Function and frame counters are written by the thread running
+ * doGlideFunc(), LFB counters by the vCPU taking the MMIO exit. A reset
+ * raised from the monitor or at grSstWinOpen is applied on the next
+ * frame boundary.
+ */
+static struct {
+    PROFENTRY func[FEnum_zzG2xFuncEnum_max];
+    FRAMEHIST hist, ivl;
+    int64_t lastFrame;
+    int64_t since;
+} prof;
+static struct {
+    uint64_t exits[2];
+    uint64_t bytes[2];
+} lfbProf;
+static int prof_reset = 1;
+
+int GRProfileActive(void) { return glide_profile(); }
+
+void GRProfileFunc(const int FEnum, const int64_t ns)
+{
+    prof.func[FEnum].calls++;
+    prof.func[FEnum].ns += ns;
+}
+
+void GRProfileLfb(const int write, const unsigned size)
+{
+    lfbProf.exits[write & 1]++;
+    lfbProf.bytes[write & 1] += size;
+}
+
+static void hist_add(FRAMEHIST *h, const uint64_t ns)
+{
+    uint64_t i = ns / (FRAME_HIST_US * 1000);
+
+    h->bucket[MIN(i, (uint64_t)FRAME_HIST_MAX)]++;
+    h->frames++;
+    h->ns += ns;
+    h->max = MAX(h->max, ns);
+}
+
+static uint64_t hist_pct(const FRAMEHIST *h, const int pct)
+{
+    uint64_t sum = 0, want = (h->frames * pct + 99) / 100;
+
+    for (int i = 0; h->frames && (i < FRAME_HIST_MAX); i++) {
+        sum += h->bucket[i];
+        if (sum >= want)
+            return MIN((uint64_t)(i + 1) * FRAME_HIST_US, h->max / 1000);
+    }
+    return h->max / 1000;
+}
+
+void GRProfileFrame(void)
+{
+    int64_t curr = get_clock();
+
+    if (qatomic_xchg(&prof_reset, 0)) {
+        memset(&prof, 0, sizeof(prof));
+        memset(&lfbProf, 0, sizeof(lfbProf));
+        prof.since = curr;
+    }
+    if (prof.lastFrame) {
+        hist_add(&prof.hist, curr - prof.lastFrame);
+        hist_add(&prof.ivl, curr - prof.lastFrame);
+    }
+    prof.lastFrame = curr;
+}
+
+int GRProfileInterval(char *buf, const int size)
+{
+    FRAMEHIST *h = &prof.ivl;
+    int ret = 0;
+
+    if (h->frames) {
+        ret = snprintf(buf, size, "p50 %.1f p95 %.1f p99 %.1f max %.1f ms",
+            hist_pct(h, 50) / 1e3, hist_pct(h, 95) / 1e3, hist_pct(h, 99) / 1e3, h->max / 1e6);
+        memset(h, 0, sizeof(FRAMEHIST));
+    }
+    return ret;
+}
+
+static gint prof_cmp(gconstpointer a, gconstpointer b)
+{
+    const PROFENTRY *pa = &prof.func[*(const int *)a],
+          *pb = &prof.func[*(const int *)b];
+
+    if (pa->ns != pb->ns)
+        return (pa->ns < pb->ns)? 1:-1;
+    if (pa->calls != pb->calls)
+        return (pa->calls < pb->calls)? 1:-1;
+    return 0;
+}
+
+static int prof_sorted(int *idx)
+{
+    int n = 0;
+
+    for (int i = 0; i < FEnum_zzG2xFuncEnum_max; i++) {
+        if (prof.func[i].calls)
+            idx[n++] = i;
+    }
+    qsort(idx, n, sizeof(int), prof_cmp);
+    return n;
+}
+
+static int sym_len(const char *sym)
+{
+    return strcspn(sym, "@") - 1;
+}
+
+static void prof_dump(GString *buf)
+{
+    g_autofree int *idx = g_new(int, FEnum_zzG2xFuncEnum_max);
+    const FRAMEHIST *h = &prof.hist;
+    uint64_t ns = 0;
+    int n = prof_sorted(idx);
+
+    for (int i = 0; i < n; i++)
+        ns += prof.func[idx[i]].ns;
+
+    g_string_append_printf(buf, "Glide profile: %.3f s sampled\n",
+        (prof.since)? ((get_clock() - prof.since) / 1e9):0);
+    g_string_append_printf(buf, "  frames %" PRIu64 " avg %.2f ms p50 %.2f p95 %.2f p99 %.2f max %.2f ms\n",
+        h->frames, (h->frames)? (h->ns / 1e6 / h->frames):0,
+        hist_pct(h, 50) / 1e3, hist_pct(h, 95) / 1e3, hist_pct(h, 99) / 1e3, h->max / 1e6);
+    g_string_append_printf(buf, "  LFB MMIO read %" PRIu64 " (%" PRIu64 " KB) write %" PRIu64 " (%" PRIu64 " KB)\n",
+        lfbProf.exits[0], lfbProf.bytes[0] >> 10, lfbProf.exits[1], lfbProf.bytes[1] >> 10);
+    if (glide_texcache()) {
+        TEXCACHESTAT tc;
+        StatTexCache(&tc);
+        g_string_append_printf(buf, "  TexCache hit %u miss %u (%.1f%%) evict %u skipped %" PRIu64 " KB\n",
+            tc.hit, tc.miss, (tc.hit + tc.miss)? ((100.0 * tc.hit) / (tc.hit + tc.miss)):0,
+            tc.evict, tc.skip >> 10);
+        g_string_append_printf(buf, "  TexTable hit %u miss %u\n", tc.tblHit, tc.tblMiss);
+    }
+    g_string_append_printf(buf, "%12s %12s %9s %6s  %s\n",
+        "calls", "host-us", "avg-ns", "host%", "function");
+    for (int i = 0; i < n; i++) {
+        const PROFENTRY *p = &prof.func[idx[i]];
+        const char *sym = GRFEnumFuncSym(idx[i]);
+        g_string_append_printf(buf, "%12" PRIu64 " %12" PRIu64 " %9" PRIu64 " %6.2f  %.*s\n",
+            p->calls, p->ns / 1000, p->ns / p->calls,
+            (ns)? ((100.0 * p->ns) / ns):0, sym_len(sym), sym + 1);
+    }
+}
+
+void GRProfileOpen(void)
+{
+    qatomic_set(&prof_reset, 1);
+}
+
+void GRProfileClose(void)
+{
+    g_autoptr(GDateTime) now = g_date_time_new_now_local();
+    g_autofree char *stamp = g_date_time_format(now, "%Y%m%d-%H%M%S");
+    g_autofree char *name = g_strdup_printf("glide-profile-%s.csv", stamp);
+    g_autofree int *idx = g_new(int, FEnum_zzG2xFuncEnum_max);
+    const FRAMEHIST *h = &prof.hist;
+    FILE *fp;
+    int n;
+
+    if (!GRProfileActive() || qatomic_read(&prof_reset))
+        return;
+
+    fp = fopen(name, "w");
+    if (!fp) {
+        DPRINTF("Glide profile %s open failed", name);
+        return;
+    }
+    fprintf(fp, "section,name,count,total_us,bytes\n");
+    fprintf(fp, "session,seconds,,%" PRIu64 ",\n", (get_clock() - prof.since) / 1000);
+    fprintf(fp, "frame,all,%" PRIu64 ",%" PRIu64 ",\n", h->frames, h->ns / 1000);
+    fprintf(fp, "frame,p50,,%" PRIu64 ",\n", hist_pct(h, 50));
+    fprintf(fp, "frame,p95,,%" PRIu64 ",\n", hist_pct(h, 95));
+    fprintf(fp, "frame,p99,,%" PRIu64 ",\n", hist_pct(h, 99));
+    fprintf(fp, "frame,max,,%" PRIu64 ",\n", h->max / 1000);
+    fprintf(fp, "lfb,read,%" PRIu64 ",,%" PRIu64 "\n", lfbProf.exits[0], lfbProf.bytes[0]);
+    fprintf(fp, "lfb,write,%" PRIu64 ",,%" PRIu64 "\n", lfbProf.exits[1], lfbProf.bytes[1]);
+    n = prof_sorted(idx);
+    for (int i = 0; i < n; i++) {
+        const char *sym = GRFEnumFuncSym(idx[i]);
+        fprintf(fp, "func,%.*s,%" PRIu64 ",%" PRIu64 ",\n", sym_len(sym), sym + 1,
+            prof.func[idx[i]].calls, prof.func[idx[i]].ns / 1000);
+    }
+    for (int i = 0; i <= FRAME_HIST_MAX; i++) {
+        if (h->bucket[i])
+            fprintf(fp, "hist,%d,%u,,\n", i * FRAME_HIST_US, h->bucket[i]);
+    }
+    fclose(fp);
+    DPRINTF("Glide profile written to %s", name);
+}
+
+HumanReadableText *qmp_x_query_glidept_profile(bool has_reset, bool reset,
+                                               Error **errp)
+{
+    g_autoptr(GString) buf = g_string_new("");
+
+    if (!GRProfileActive()) {
+        error_setg(errp, "Glide profiler is disabled, set FuncProfile,1 in glide.cfg");
+        return NULL;
+    }
+    if (qatomic_read(&prof_reset))
+        g_string_append_printf(buf, "Glide profile: reset pending\n");
+    else
+        prof_dump(buf);
+    if (has_reset && reset)
+        qatomic_set(&prof_reset, 1);
+
+    return human_readable_text_from_str(buf);
+}
+
+static void hmp_info_glidept_profile(Monitor *mon, const QDict *qdict)
+{
+    Error *err = NULL;
+    g_autoptr(HumanReadableText) info =
+        qmp_x_query_glidept_profile(true, qdict_get_try_bool(qdict, "reset", false), &err);
+
+    if (err) {
+        error_report_err(err);
+        return;
+    }
+    monitor_puts(mon, info->human_readable_text);
+}
+
+void GRProfileRegister(void)
+{
+    monitor_register_hmp("glidept-profile", true, hmp_info_glidept_profile);
+}
@@ -0,0 +1,33 @@
+/*
+ * QEMU 3Dfx Glide Pass-Through
+ *
+ *  Copyright (c) 2018-2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GLIDEPROF_H
+#define GLIDEPROF_H
+
+int GRProfileActive(void);
+void GRProfileFunc(const int, const int64_t);
+void GRProfileFrame(void);
+int GRProfileInterval(char *, const int);
+void GRProfileLfb(const int, const unsigned);
+void GRProfileOpen(void);
+void GRProfileClose(void);
+void GRProfileRegister(void);
+
+#endif // GLIDEPROF_H
@@ -23,7 +23,13 @@
 #include "hw/hw.h"
 #include "hw/i386/pc.h"
 #include "hw/sysbus.h"
+#include "hw/qdev-properties.h"
+#include "hw/ptpace.h"
+#include "hw/pttrace.h"
 #include "exec/address-spaces.h"
+#include "qemu/thread.h"
+#include "qemu/bitmap.h"
+#include "qemu/main-loop.h"
 
 #include "glide2x_impl.h"
 #include "gllstbuf.h"
@@ -67,8 +73,15 @@ typedef struct GlideLfbState
     int begin;
     int v1Lfb;
     int emu211;
+    struct GlidePTState *ptDev;
 } GlideLfbState;
 
+typedef struct {
+    uint32_t *fifo, *data;
+    uint32_t FEnum;
+    int busy;
+} GRFIFOBUF;
+
 typedef struct GlidePTState
 {
     SysBusDevice parent_obj;
@@ -84,6 +97,9 @@ typedef struct GlidePTState
     uint8_t *glfb_ptr;
     int lfb_dirty, lfb_real, lfb_noaux, lfb_merge;
     int lfb_w, lfb_h;
+    int lfb_track, lfb_req, lfb_swap;
+    uint32_t lfb_stride;
+    unsigned long *lfb_rows[2];
 
     GlideLfbState *lfbDev;
     uint32_t szGrState;
@@ -99,11 +115,22 @@ typedef struct GlidePTState
     int cfgPushed;
     wrTexStruct GrTex;
     PERFSTAT perfs;
+    QemuThread dispThread;
+    QemuMutex dispMutex;
+    QemuCond dispCond, dispIdle;
+    GRFIFOBUF dispBuf[2];
+    int dispNext, dispTail;
+    int dispActive, dispPend, dispRead, dispQuit;
+    hwaddr dispAddr;
+    uint64_t dispVal;
+    uint32_t dispAsync, dispSync;
+    char *traceRecord, *traceReplay;
+    PTTrace *trace;
+    PTPace *pace;
 } GlidePTState;
 
-static uint64_t glidept_read(void *opaque, hwaddr addr, unsigned size)
+static uint64_t glidept_read_sync(GlidePTState *s, hwaddr addr)
 {
-    GlidePTState *s = opaque;
     uint64_t val;
 
     switch (addr) {
@@ -179,6 +206,14 @@ static void vgLfbFlush(GlidePTState *s)
     uint8_t *hLfb = s->lfbDev->lfbPtr[1];
     if (hLfb == 0)
         DPRINTF("WARN: LFB write pointer is NULL");
+    else if (s->lfb_track && (gLfb == s->glfb_ptr) && (s->lfb_stride == stride)) {
+        unsigned long *rows = s->lfb_rows[s->lfb_swap & 0x01U];
+        for (int y = find_first_bit(rows, s->lfb_h); y < s->lfb_h;
+                y = find_next_bit(rows, s->lfb_h, y + 1)) {
+            memcpy(hLfb + (y * s->lfbDev->stride[1]), gLfb + (y * stride), xwidth);
+            clear_bit(y, rows);
+        }
+    }
     else {
         for (int y = 0; y < s->lfb_h; y++) {
             memcpy(hLfb, gLfb, xwidth);
@@ -188,6 +223,66 @@ static void vgLfbFlush(GlidePTState *s)
     }
 }
 
+/*
+ * Dirty rows are gathered under the BQL at the doorbell of a call that
+ * flushes the LFB, before it is handed to the dispatch thread, which
+ * is idle at that point. vgLfbFlush only consumes the row bitmaps.
+ */
+static void vgLfbSync(GlidePTState *s, uint32_t FEnum)
+{
+    uint32_t stride, xwidth;
+    DirtyBitmapSnapshot *snap;
+
+    switch (FEnum) {
+        case FEnum_grBufferSwap:
+        case FEnum_grLfbUnlock:
+        case FEnum_grLfbEnd:
+            break;
+        default:
+            return;
+    }
+    if (!s->lfb_track || !qemu_mutex_iothread_locked())
+        return;
+    stride = ((s->lfbDev->writeMode & 0x0EU) == 0x04)? 0x1000:0x800;
+    xwidth = ((s->lfbDev->writeMode & 0x0EU) == 0x04)? (s->lfb_w << 2):(s->lfb_w << 1);
+    snap = memory_region_snapshot_and_clear_dirty(&s->glfb_ram,
+        0, s->lfb_h * stride, DIRTY_MEMORY_VGA);
+    if (s->lfb_stride != stride) {
+        s->lfb_stride = stride;
+        bitmap_fill(s->lfb_rows[0], s->lfb_h);
+        bitmap_fill(s->lfb_rows[1], s->lfb_h);
+    }
+    for (int y = 0; y < s->lfb_h; y++) {
+        if (memory_region_snapshot_get_dirty(&s->glfb_ram, snap, y * stride, xwidth)) {
+            set_bit(y, s->lfb_rows[0]);
+            set_bit(y, s->lfb_rows[1]);
+        }
+    }
+    g_free(snap);
+}
+
+static void vgLfbTrack(GlidePTState *s, int enable)
+{
+    if ((s->lfb_track == enable) || !qemu_mutex_iothread_locked())
+        return;
+    s->lfb_track = enable;
+    memory_region_set_log(&s->glfb_ram, enable, DIRTY_MEMORY_VGA);
+    if (enable) {
+        s->lfb_rows[0] = bitmap_new(0x300);
+        s->lfb_rows[1] = bitmap_new(0x300);
+        bitmap_fill(s->lfb_rows[0], 0x300);
+        bitmap_fill(s->lfb_rows[1], 0x300);
+        s->lfb_stride = 0;
+        s->lfb_swap = 0;
+    }
+    else {
+        g_free(s->lfb_rows[0]);
+        g_free(s->lfb_rows[1]);
+        s->lfb_rows[0] = 0;
+        s->lfb_rows[1] = 0;
+    }
+}
+
 #define PTR(x,y) (((uint8_t *)x)+y)
 #define VAL(x) (uintptr_t)x
 static void processArgs(GlidePTState *s)
@@ -340,12 +435,16 @@ static void processArgs(GlidePTState *s)
                 if (s->lfb_dirty & 0x80U)
                     wrWriteRegion(1, 0, 0, 0, s->lfb_w, s->lfb_h, 0x800, (uintptr_t)(s->glfb_ptr));
                 s->lfb_dirty = 1;
+                s->lfb_swap++;
             }
             if (glide_vsyncoff())
                 s->arg[0] = 0;
             if (GRFuncTrace() == 2)
                 DPRINTF(">>>>>>>> _grBufferSwap <<<<<<<<");
+            if (GRProfileActive())
+                GRProfileFrame();
             s->perfs.stat();
+            ptpace_swap_begin(s->pace);
             break;
 	case FEnum_grLfbLock:
             s->datacb = ALIGNED(SIZE_GRLFBINFO);
@@ -372,6 +471,11 @@ static void processArgs(GlidePTState *s)
 	case FEnum_grLfbReadRegion:
 	    s->parg[2] = VAL(s->hshm);
 	    break;
+        case FEnum_grBufferClear:
+        case FEnum_grBufferClearExt:
+            if (s->lfb_track)
+                bitmap_fill(s->lfb_rows[s->lfb_swap & 0x01U], s->lfb_h);
+            break;
         case FEnum_grLfbWriteRegion:
             s->datacb = ALIGNED(s->arg[5] * s->arg[6]);
             s->parg[3] = VAL(s->hshm);
@@ -636,6 +740,7 @@ static void processFRet(GlidePTState *s)
             s->disp_cb.FEnum = s->FEnum;
             init_window(s->arg[0], s->version, &s->disp_cb);
             s->lfbDev->guestLfb = s->arg[6];
+            GRProfileOpen();
 	    break;
 	case FEnum_grSstWinOpen:
         case FEnum_grSstWinOpenExt:
@@ -661,11 +766,16 @@ static void processFRet(GlidePTState *s)
                     s->lfb_h = (s->lfb_h > 0x300)? 0x300:s->lfb_h;
                     memset(s->glfb_ptr + (s->lfb_h * 0x800), 0, (s->lfb_h * 0x800));
                 }
-                DPRINTF("LFB mode is %s%s-copy%s%s%s%s", (s->lfb_real)? "MMIO Handlers (slow)" : "Shared Memory (fast)",
+                s->lfb_req = ((s->lfb_real == 0) && !s->lfb_merge && !glide_mapbufo(0, 0) && !s->trace)?
+                    glide_lfbdirtytrack():0;
+                GRProfileOpen();
+                ptpace_config(s->pace, (glide_dispatchthread())? glide_framepacing():PTPACE_OFF, glide_fpslimit());
+                DPRINTF("LFB mode is %s%s-copy%s%s%s%s%s", (s->lfb_real)? "MMIO Handlers (slow)" : "Shared Memory (fast)",
                         (s->lfb_real || glide_mapbufo(0, 0))? ", Zero":", One",
                         (glide_fpslimit())? strFpsLimit:"",
                         (glide_lfbdirty())? ", LfbLockDirty":"",
-                        (s->lfb_noaux)? ", LfbNoAux":"", (s->lfb_merge)? ", LfbWriteMerge":"");
+                        (s->lfb_noaux)? ", LfbNoAux":"", (s->lfb_merge)? ", LfbWriteMerge":"",
+                        (s->lfb_req)? ", LfbDirtyTrack":"");
 	    }
 	    break;
 	case FEnum_grSstWinClose:
@@ -673,7 +783,10 @@ static void processFRet(GlidePTState *s)
             s->disp_cb.arg = s->arg;
             s->disp_cb.FEnum = s->FEnum;
 	    fini_window(&s->disp_cb);
+            s->lfb_req = 0;
 	    s->perfs.last();
+            GRProfileClose();
+            ptpace_config(s->pace, PTPACE_OFF, 0);
 	    DPRINTF("%-64s", "grSstWinClose called");
 	    break;
 	case FEnum_grGlideInit:
@@ -708,6 +821,19 @@ static void processFRet(GlidePTState *s)
 	    /* TODO - Window management */
 	    DPRINTF("grGlideShutdown called, fifo 0x%04x data 0x%04x shm 0x%07x lfb 0x%07x",
                     s->fifoMax, s->dataMax, (MAX_FIFO + s->dataMax) << 2, GLIDE_LFB_BASE + s->lfbDev->lfbMax);
+            do {
+                STBUFSTAT st[2];
+                StatGrState(&st[0]);
+                StatVtxLayout(&st[1]);
+                DPRINTF("  GrState hit %u miss %u VtxLayout hit %u miss %u",
+                        st[0].hit, st[0].miss, st[1].hit, st[1].miss);
+            } while(0);
+            if (glide_texcache()) {
+                TEXCACHESTAT tc;
+                StatTexCache(&tc);
+                DPRINTF("  TexCache hit %u miss %u evict %u skipped %" PRIu64 " KB TexTable hit %u miss %u",
+                        tc.hit, tc.miss, tc.evict, tc.skip >> 10, tc.tblHit, tc.tblMiss);
+            }
             DPRINTF("  GrState %d VtxLayout %d", FreeGrState(), FreeVtxLayout());
 	    memset(s->arg, 0, sizeof(uint32_t [16]));
 	    strncpy(s->version, "Glide2x", sizeof(char [80])-1);
@@ -718,7 +844,8 @@ static void processFRet(GlidePTState *s)
 	    break;
 
         case FEnum_grBufferSwap:
-            s->FRet = glide_fpslimit();
+            ptpace_swap_end(s->pace);
+            s->FRet = (ptpace_active(s->pace))? 0:glide_fpslimit();
             break;
 	case FEnum_grLfbLock:
 	    if (s->lfbDev->lock[s->arg[0] & 0x1U] == 1) {
@@ -867,10 +994,8 @@ static void processFRet(GlidePTState *s)
     }
 }
 
-static void processFifo(GlidePTState *s)
+static void processFifoBatch(GlidePTState *s, uint32_t *fifoptr, uint32_t *dataptr)
 {
-    uint32_t *fifoptr = (uint32_t *)s->fifo_ptr;
-    uint32_t *dataptr = (uint32_t *)(s->fifo_ptr + (MAX_FIFO << 2));
     int FEnum = s->FEnum, i = FIRST_FIFO, j = ALIGNED(1) >> 2;
     struct {
         uint32_t fifo;
@@ -929,10 +1054,43 @@ static void processFifo(GlidePTState *s)
     }
 }
 
-static void glidept_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
+static void processFifo(GlidePTState *s)
+{
+    processFifoBatch(s, (uint32_t *)s->fifo_ptr, (uint32_t *)(s->fifo_ptr + (MAX_FIFO << 2)));
+}
+
+static int FEnumDispatchAsync(const uint32_t FEnum)
+{
+    switch (FEnum) {
+        case FEnum_grAADrawLine:
+        case FEnum_grAADrawPoint:
+        case FEnum_grAADrawPolygon:
+        case FEnum_grAADrawPolygonVertexList:
+        case FEnum_grAADrawTriangle:
+        case FEnum_grDrawLine:
+        case FEnum_grDrawPlanarPolygon:
+        case FEnum_grDrawPlanarPolygonVertexList:
+        case FEnum_grDrawPoint:
+        case FEnum_grDrawPolygon:
+        case FEnum_grDrawPolygonVertexList:
+        case FEnum_grDrawTriangle:
+        case FEnum_grDrawVertexArray:
+        case FEnum_grDrawVertexArrayContiguous:
+        case FEnum_guAADrawTriangleWithClip:
+        case FEnum_guDrawPolygonVertexListWithClip:
+        case FEnum_guDrawTriangleWithClip:
+        case FEnum_grBufferClear:
+        case FEnum_grBufferClearExt:
+            return 1;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static void glidept_write_sync(GlidePTState *s, hwaddr addr, uint64_t val)
 {
     COMMIT_SIGN;
-    GlidePTState *s = opaque;
 
     switch (addr) {
 	case 0xfb0:
@@ -1014,6 +1172,186 @@ static void glidept_write(void *opaque, hwaddr addr, uint64_t val, unsigned size
     }
 }
 
+static void processDispatchBatch(GlidePTState *s, GRFIFOBUF *buf)
+{
+    s->FEnum = buf->FEnum;
+    processFifoBatch(s, buf->fifo, buf->data);
+    processArgs(s);
+    doGlideFunc(s->FEnum, s->arg, s->parg, &s->FRet, s->lfbDev->emu211);
+    processFRet(s);
+}
+
+static void *glidept_dispatch_thread(void *opaque)
+{
+    GlidePTState *s = opaque;
+    GRFIFOBUF *buf;
+
+    qemu_mutex_lock(&s->dispMutex);
+    while (1) {
+        buf = &s->dispBuf[s->dispTail];
+        if (buf->busy) {
+            qemu_mutex_unlock(&s->dispMutex);
+            ptpace_hold(s->pace);
+            processDispatchBatch(s, buf);
+            qemu_mutex_lock(&s->dispMutex);
+            buf->busy = 0;
+            s->dispTail ^= 1;
+            qemu_cond_broadcast(&s->dispIdle);
+        }
+        else if (s->dispPend) {
+            qemu_mutex_unlock(&s->dispMutex);
+            ptpace_hold(s->pace);
+            if (s->dispRead)
+                s->dispVal = glidept_read_sync(s, s->dispAddr);
+            else
+                glidept_write_sync(s, s->dispAddr, s->dispVal);
+            qemu_mutex_lock(&s->dispMutex);
+            s->dispPend = 0;
+            qemu_cond_broadcast(&s->dispIdle);
+        }
+        else if (s->dispQuit)
+            break;
+        else
+            qemu_cond_wait(&s->dispCond, &s->dispMutex);
+    }
+    qemu_mutex_unlock(&s->dispMutex);
+
+    return NULL;
+}
+
+static void dispWaitIdle(GlidePTState *s)
+{
+    qemu_mutex_lock(&s->dispMutex);
+    while (s->dispBuf[0].busy || s->dispBuf[1].busy || s->dispPend)
+        qemu_cond_wait(&s->dispIdle, &s->dispMutex);
+    qemu_mutex_unlock(&s->dispMutex);
+}
+
+static uint64_t dispCallSync(GlidePTState *s, hwaddr addr, uint64_t val, int rd)
+{
+    qemu_mutex_lock(&s->dispMutex);
+    while (s->dispBuf[0].busy || s->dispBuf[1].busy || s->dispPend)
+        qemu_cond_wait(&s->dispIdle, &s->dispMutex);
+    s->dispAddr = addr;
+    s->dispVal = val;
+    s->dispRead = rd;
+    s->dispPend = 1;
+    s->dispSync++;
+    qemu_cond_signal(&s->dispCond);
+    while (s->dispPend)
+        qemu_cond_wait(&s->dispIdle, &s->dispMutex);
+    val = s->dispVal;
+    qemu_mutex_unlock(&s->dispMutex);
+
+    return val;
+}
+
+static void dispQueueBatch(GlidePTState *s, uint32_t FEnum)
+{
+    uint32_t *fifoptr = (uint32_t *)s->fifo_ptr,
+             *dataptr = (uint32_t *)(s->fifo_ptr + (MAX_FIFO << 2));
+    uint32_t numFifo = MAX(MIN(fifoptr[0], MAX_FIFO), FIRST_FIFO),
+             numData = MIN(dataptr[0], MAX_DATA);
+    GRFIFOBUF *buf = &s->dispBuf[s->dispNext];
+
+    qemu_mutex_lock(&s->dispMutex);
+    while (buf->busy)
+        qemu_cond_wait(&s->dispIdle, &s->dispMutex);
+    qemu_mutex_unlock(&s->dispMutex);
+
+    memcpy(buf->fifo, fifoptr, numFifo * sizeof(uint32_t));
+    memcpy(buf->data, dataptr, numData * sizeof(uint32_t));
+    buf->FEnum = FEnum;
+    fifoptr[0] = FIRST_FIFO;
+    dataptr[0] = ALIGNED(1) >> 2;
+
+    qemu_mutex_lock(&s->dispMutex);
+    buf->busy = 1;
+    s->dispNext ^= 1;
+    s->dispAsync++;
+    qemu_cond_signal(&s->dispCond);
+    qemu_mutex_unlock(&s->dispMutex);
+}
+
+static void dispStart(GlidePTState *s)
+{
+    for (int i = 0; i < 2; i++) {
+        s->dispBuf[i].fifo = g_new0(uint32_t, MAX_FIFO);
+        s->dispBuf[i].data = g_new0(uint32_t, MAX_DATA);
+        s->dispBuf[i].busy = 0;
+    }
+    s->dispNext = 0;
+    s->dispTail = 0;
+    s->dispPend = 0;
+    s->dispQuit = 0;
+    s->dispAsync = 0;
+    s->dispSync = 0;
+    qemu_thread_create(&s->dispThread, "glidept-dispatch", glidept_dispatch_thread, s, QEMU_THREAD_JOINABLE);
+    s->dispActive = 1;
+    DPRINTF("DispatchThread started");
+}
+
+static void dispStop(GlidePTState *s)
+{
+    dispWaitIdle(s);
+    qemu_mutex_lock(&s->dispMutex);
+    s->dispQuit = 1;
+    qemu_cond_signal(&s->dispCond);
+    qemu_mutex_unlock(&s->dispMutex);
+    qemu_thread_join(&s->dispThread);
+    s->dispActive = 0;
+    for (int i = 0; i < 2; i++) {
+        g_free(s->dispBuf[i].fifo);
+        g_free(s->dispBuf[i].data);
+        s->dispBuf[i].fifo = 0;
+        s->dispBuf[i].data = 0;
+    }
+    DPRINTF("DispatchThread stopped, batches async %u sync %u", s->dispAsync, s->dispSync);
+}
+
+static uint64_t glidept_read(void *opaque, hwaddr addr, unsigned size)
+{
+    GlidePTState *s = opaque;
+    uint64_t val;
+
+    val = (s->dispActive)? dispCallSync(s, addr, 0, 1):glidept_read_sync(s, addr);
+    if (s->trace && s->traceRecord && (addr == 0xfb8))
+        pttrace_read(s->trace, addr, val);
+
+    return val;
+}
+
+static void glidept_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
+{
+    GlidePTState *s = opaque;
+
+    if (s->trace && s->traceRecord)
+        pttrace_doorbell(s->trace, addr, val);
+
+    if (!s->dispActive) {
+        if (addr == 0xfc0)
+            vgLfbSync(s, val);
+        glidept_write_sync(s, addr, val);
+        vgLfbTrack(s, s->lfb_req);
+        if ((addr == 0xfc0) && s->disp_cb.activate && glide_dispatchthread())
+            dispStart(s);
+        return;
+    }
+
+    if ((addr == 0xfc0) && FEnumDispatchAsync(val))
+        dispQueueBatch(s, val);
+    else {
+        if (addr == 0xfc0) {
+            dispWaitIdle(s);
+            vgLfbSync(s, val);
+        }
+        dispCallSync(s, addr, val, 0);
+        vgLfbTrack(s, s->lfb_req);
+        if ((addr == 0xfbc) && !s->initDLL)
+            dispStop(s);
+    }
+}
+
 static hwaddr translateLfb(const hwaddr offset_in, const int stride)
 {
     uint32_t x, y;
@@ -1031,6 +1369,12 @@ static uint64_t glideLfb_read(void *opaque, hwaddr addr, unsigned size)
     s->lfbMax = (s->lfbMax < addr)? addr:s->lfbMax;
     uint32_t val = 0;
 
+    if (GRProfileActive())
+        GRProfileLfb(0, size);
+
+    if (s->ptDev && s->ptDev->dispActive)
+        dispWaitIdle(s->ptDev);
+
     if (s->lfbPtr[0]) {
 	if (!s->v1Lfb && !s->lock[0]) {
 	    DPRINTF("LFB read without lock!");
@@ -1062,6 +1406,15 @@ static void glideLfb_write(void *opaque, hwaddr addr, uint64_t val, unsigned siz
     GlideLfbState *s = opaque;
     s->lfbMax = (s->lfbMax < addr)? addr:s->lfbMax;
 
+    if (s->ptDev && s->ptDev->trace && s->ptDev->traceRecord)
+        pttrace_mmio(s->ptDev->trace, addr, val, size);
+
+    if (GRProfileActive())
+        GRProfileLfb(1, size);
+
+    if (s->ptDev && s->ptDev->dispActive)
+        dispWaitIdle(s->ptDev);
+
     if (s->lfbPtr[1]) {
 	if (!s->v1Lfb && !s->lock[1] && false) {
 	   DPRINTF("LFB write without lock!");
@@ -1145,8 +1498,34 @@ static void glidept_init(Object *obj)
 
     memory_region_init_io(&s->iomem, obj, &glidept_ops, s, TYPE_GLIDEPT, PAGE_SIZE);
     sysbus_init_mmio(sbd, &s->iomem);
+
+    qemu_mutex_init(&s->dispMutex);
+    qemu_cond_init(&s->dispCond);
+    qemu_cond_init(&s->dispIdle);
 }
 
+static void glidept_trace_doorbell(void *opaque, hwaddr addr, uint64_t val)
+{
+    glidept_write(opaque, addr, val, sizeof(uint32_t));
+}
+
+static void glidept_trace_mmio(void *opaque, hwaddr addr, uint64_t val, unsigned size)
+{
+    GlidePTState *s = opaque;
+    glideLfb_write(s->lfbDev, addr, val, size);
+}
+
+static uint64_t glidept_trace_read(void *opaque, hwaddr addr)
+{
+    return glidept_read(opaque, addr, sizeof(uint32_t));
+}
+
+static const PTTraceOps glidept_trace_ops = {
+    .doorbell = glidept_trace_doorbell,
+    .mmio = glidept_trace_mmio,
+    .read = glidept_trace_read,
+};
+
 static void glidept_realize(DeviceState *dev, Error **errp)
 {
     GlidePTState *s = GLIDEPT(dev);
@@ -1157,9 +1536,28 @@ static void glidept_realize(DeviceState *dev, Error **errp)
     sysbus_mmio_map(SYS_BUS_DEVICE(lfb), 0, GLIDE_LFB_BASE);
 
     s->lfbDev = GLIDELFB(lfb);
+    s->lfbDev->ptDev = s;
     s->initDLL = 0;
+    s->pace = ptpace_new("glidept");
+
+    MemoryRegion *mr[] = { &s->fifo_ram, &s->glfb_ram };
+    if (s->traceRecord && s->traceReplay) {
+        error_setg(errp, "glidept: record and replay are mutually exclusive");
+        return;
+    }
+    if (s->traceRecord)
+        s->trace = pttrace_record(s->traceRecord, PTTRACE_DEV_GLIDE, mr, ARRAY_SIZE(mr), errp);
+    if (s->traceReplay)
+        s->trace = pttrace_replay(s->traceReplay, PTTRACE_DEV_GLIDE, mr, ARRAY_SIZE(mr),
+            &glidept_trace_ops, s, errp);
 }
 
+static Property glidept_properties[] = {
+    DEFINE_PROP_STRING("record", GlidePTState, traceRecord),
+    DEFINE_PROP_STRING("replay", GlidePTState, traceReplay),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
 static void glidept_finalize(Object *obj)
 {
   //  GlidePTState *s = GLIDEPT(obj);
@@ -1188,6 +1586,7 @@ static void glidept_class_init(ObjectClass *klass, void *data)
 
     dc->realize = glidept_realize;
     dc->reset = glidept_reset;
+    device_class_set_props(dc, glidept_properties);
 }
 
 static const TypeInfo glidelfb_info = {
@@ -1211,6 +1610,7 @@ static void glidept_register_type(void)
 {
     type_register_static(&glidelfb_info);
     type_register_static(&glidept_info);
+    GRProfileRegister();
 }
 
 type_init(glidept_register_type)
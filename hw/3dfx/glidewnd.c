@@ -60,15 +60,20 @@ static int cfg_cntxMSAA;
 static int cfg_cntxSRGB;
 static int cfg_cntxVsyncOff;
 static int cfg_fpsLimit;
+static int cfg_framePacing;
 static int cfg_lfbHandler;
 static int cfg_lfbNoAux;
 static int cfg_lfbLockDirty;
 static int cfg_lfbWriteMerge;
 static int cfg_lfbMapBufo;
+static int cfg_lfbDirtyTrack;
 static int cfg_Annotate;
 static int cfg_MipMaps;
+static int cfg_dispatchThread;
 static int cfg_traceFifo;
 static int cfg_traceFunc;
+static int cfg_profFunc;
+static int cfg_texCache;
 static void *hwnd;
 
 #ifdef CONFIG_DARWIN
@@ -181,11 +186,16 @@ static int scaledRes(int w, float r)
 int GRFifoTrace(void) { return cfg_traceFifo; }
 int GRFuncTrace(void) { return (cfg_traceFifo)? 0:cfg_traceFunc; }
 int glide_fpslimit(void) { return cfg_fpsLimit; }
+int glide_framepacing(void) { return cfg_framePacing; }
 int glide_vsyncoff(void) { return cfg_cntxVsyncOff; }
 int glide_lfbmerge(void) { return (cfg_lfbMapBufo)? 0:cfg_lfbWriteMerge; }
 int glide_lfbdirty(void) { return (cfg_lfbMapBufo)? 0:cfg_lfbLockDirty; }
 int glide_lfbnoaux(void) { return cfg_lfbNoAux; }
 int glide_lfbmode(void) { return cfg_lfbHandler; }
+int glide_lfbdirtytrack(void) { return (cfg_lfbMapBufo)? 0:cfg_lfbDirtyTrack; }
+int glide_dispatchthread(void) { return cfg_dispatchThread; }
+int glide_profile(void) { return cfg_profFunc; }
+int glide_texcache(void) { return cfg_texCache; }
 void glide_winres(const int res, int *w, int *h)
 {
     *w = tblRes[res].w;
@@ -245,15 +255,20 @@ void init_window(const int res, const char *wndTitle, void *opaque)
     cfg_cntxSRGB = 0;
     cfg_cntxVsyncOff = 0;
     cfg_fpsLimit = 0;
+    cfg_framePacing = 0;
     cfg_lfbHandler = 0;
     cfg_lfbNoAux = 0;
     cfg_lfbLockDirty = 0;
     cfg_lfbWriteMerge = 0;
     cfg_lfbMapBufo = 0;
+    cfg_lfbDirtyTrack = 0;
     cfg_Annotate = 0;
     cfg_MipMaps = 0;
+    cfg_dispatchThread = 0;
     cfg_traceFifo = 0;
     cfg_traceFunc = 0;
+    cfg_profFunc = 0;
+    cfg_texCache = 0;
 
     FILE *fp = fopen(GLIDECFG, "r");
     if (fp != NULL) {
@@ -272,6 +287,8 @@ void init_window(const int res, const char *wndTitle, void *opaque)
             cfg_cntxVsyncOff = ((i == 1) && c)? 1:cfg_cntxVsyncOff;
             i = sscanf(line, "FpsLimit,%d", &c);
             cfg_fpsLimit = (i == 1)? (c & 0x7FU):cfg_fpsLimit;
+            i = sscanf(line, "FramePacing,%d", &c);
+            cfg_framePacing = (i == 1)? (c % 3):cfg_framePacing;
             i = sscanf(line, "LfbHandler,%d", &c);
             cfg_lfbHandler = ((i == 1) && c)? 1:cfg_lfbHandler;
             i = sscanf(line, "LfbNoAux,%d", &c);
@@ -282,14 +299,22 @@ void init_window(const int res, const char *wndTitle, void *opaque)
             cfg_lfbWriteMerge = ((i == 1) && c)? 1:cfg_lfbWriteMerge;
             i = sscanf(line, "LfbMapBufo,%d", &c);
             cfg_lfbMapBufo = ((i == 1) && c)? 1:cfg_lfbMapBufo;
+            i = sscanf(line, "LfbDirtyTrack,%d", &c);
+            cfg_lfbDirtyTrack = ((i == 1) && c)? 1:cfg_lfbDirtyTrack;
             i = sscanf(line, "Annotate,%d", &c);
             cfg_Annotate = ((i == 1) && c)? 1:cfg_Annotate;
             i = sscanf(line, "MipMaps,%d", &c);
             cfg_MipMaps = ((i == 1) && c)? 1:cfg_MipMaps;
+            i = sscanf(line, "DispatchThread,%d", &c);
+            cfg_dispatchThread = ((i == 1) && c)? 1:cfg_dispatchThread;
             i = sscanf(line, "FifoTrace,%d", &c);
             cfg_traceFifo = ((i == 1) && c)? 1:cfg_traceFifo;
             i = sscanf(line, "FuncTrace,%d", &c);
             cfg_traceFunc = ((i == 1) && c)? (c % 3):cfg_traceFunc;
+            i = sscanf(line, "FuncProfile,%d", &c);
+            cfg_profFunc = ((i == 1) && c)? 1:cfg_profFunc;
+            i = sscanf(line, "TexCache,%d", &c);
+            cfg_texCache = ((i == 1) && c)? 1:cfg_texCache;
 	}
         fclose(fp);
     }
@@ -347,8 +372,11 @@ static void profile_dump(void)
 {
     PSTATSFX p = &fxstats;
     if (p->last) {
+        char pct[64];
 	p->last = 0;
-	fprintf(stderr, "%-4u frames in %-4.1f seconds, %-4.1f FPS%-8s\r", p->fcount, p->ftime, (p->fcount / p->ftime)," ");
+        if (!GRProfileActive() || !GRProfileInterval(pct, sizeof(pct)))
+            pct[0] = '\0';
+	fprintf(stderr, "%-4u frames in %-4.1f seconds, %-4.1f FPS %s%-8s\r", p->fcount, p->ftime, (p->fcount / p->ftime), pct, " ");
         fflush(stderr);
     }
 }
@@ -24,11 +24,16 @@
 int GRFifoTrace(void);
 int GRFuncTrace(void);
 int glide_fpslimit(void);
+int glide_framepacing(void);
 int glide_vsyncoff(void);
 int glide_lfbmerge(void);
 int glide_lfbdirty(void);
+int glide_lfbdirtytrack(void);
 int glide_lfbnoaux(void);
 int glide_lfbmode(void);
+int glide_dispatchthread(void);
+int glide_profile(void);
+int glide_texcache(void);
 void glide_winres(const int, int *, int *);
 int stat_window(const int, void *);
 void init_window(const int, const char *, void *);
@@ -22,79 +22,112 @@
 
 #include "gllstbuf.h"
 
+#define STBUF_SLAB      64
+
+/*
+ * Handles name guest-owned state (grGlideGetState/grGlideSetState,
+ * vertex layouts) that stays live for as long as the guest holds it,
+ * so the store grows by slabs and never drops an entry on its own.
+ */
 typedef struct _llstbuf {
     uint32_t id;
-    int sz;
     uint8_t *st;
-    struct _llstbuf *next;
 } LLSTBUF, * PLLSTBUF;
 
-static PLLSTBUF llGrState = NULL;
-static PLLSTBUF llVtxLayout = NULL;
+typedef struct _stbufstore {
+    GHashTable *ht;
+    GSList *slabs;
+    GSList *freelist;
+    int sz;
+    int cnt;
+    STBUFSTAT stat;
+} STBUFSTORE, * PSTBUFSTORE;
 
-static void *LookupStBuf(PLLSTBUF *pbuf, int st_size, uint32_t handle)
+static STBUFSTORE stGrState;
+static STBUFSTORE stVtxLayout;
+
+static int FreeStBuf(PSTBUFSTORE pbuf)
 {
-    PLLSTBUF p = *pbuf;
-
-    while (p) {
-        if ((p->id == handle) && (p->sz == st_size))
-            break;
-        if (p->next == NULL)
-            break;
-        p = p->next;
-    }
-    
-    if (p == NULL) {
-        p = g_new(LLSTBUF, 1);
-        p->id = handle;
-        p->sz = st_size;
-        p->st = g_malloc(p->sz);
-        p->next = NULL;
-        *pbuf = p;
-    }
-    else {
-        if (!((p->id == handle) && (p->sz == st_size))) {
-            p->next = g_new(LLSTBUF, 1);
-            p = p->next;
-            p->id = handle;
-            p->sz = st_size;
-            p->st = g_malloc(p->sz);
-            p->next = NULL;
+    int cnt = pbuf->cnt;
+
+    if (pbuf->ht)
+        g_hash_table_destroy(pbuf->ht);
+    g_slist_free_full(pbuf->slabs, g_free);
+    g_slist_free(pbuf->freelist);
+    memset(pbuf, 0, sizeof(STBUFSTORE));
+    return cnt;
+}
+
+static void InitStBuf(PSTBUFSTORE pbuf, int st_size)
+{
+    FreeStBuf(pbuf);
+    pbuf->ht = g_hash_table_new(g_direct_hash, g_direct_equal);
+    pbuf->sz = st_size;
+}
+
+static PLLSTBUF AllocStBuf(PSTBUFSTORE pbuf)
+{
+    PLLSTBUF p;
+
+    if (pbuf->freelist == NULL) {
+        int stride = (pbuf->sz + 15) & ~15;
+        uint8_t *slab = g_malloc0((sizeof(LLSTBUF) + stride) * STBUF_SLAB);
+        uint8_t *st = slab + (sizeof(LLSTBUF) * STBUF_SLAB);
+        for (int i = 0; i < STBUF_SLAB; i++) {
+            p = &((PLLSTBUF)slab)[i];
+            p->st = st + (i * stride);
+            pbuf->freelist = g_slist_prepend(pbuf->freelist, p);
         }
+        pbuf->slabs = g_slist_prepend(pbuf->slabs, slab);
     }
-
-    return p->st;
+    p = pbuf->freelist->data;
+    pbuf->freelist = g_slist_delete_link(pbuf->freelist, pbuf->freelist);
+    pbuf->cnt++;
+    return p;
 }
 
-static int FreeStBuf(PLLSTBUF *pbuf)
+static void *LookupStBuf(PSTBUFSTORE pbuf, int st_size, uint32_t handle)
 {
-    PLLSTBUF p = *pbuf;
-    int cnt = 0;
-    while (p) {
-        PLLSTBUF next = p->next;
-        g_free(p->st);
-        g_free(p);
-        p = next;
-        cnt++;
+    PLLSTBUF p;
+
+    if (!pbuf->ht || (pbuf->sz != st_size))
+        InitStBuf(pbuf, st_size);
+
+    p = g_hash_table_lookup(pbuf->ht, GUINT_TO_POINTER(handle));
+    if (p)
+        pbuf->stat.hit++;
+    else {
+        pbuf->stat.miss++;
+        p = AllocStBuf(pbuf);
+        p->id = handle;
+        memset(p->st, 0, pbuf->sz);
+        g_hash_table_insert(pbuf->ht, GUINT_TO_POINTER(handle), p);
     }
-    *pbuf = p;
-    return cnt;
+
+    return p->st;
 }
 
 void *LookupGrState(uint32_t handle, int size)
 {
-    return LookupStBuf(&llGrState, size, handle);
+    return LookupStBuf(&stGrState, size, handle);
 }
 void *LookupVtxLayout(uint32_t handle, int size)
 {
-    return LookupStBuf(&llVtxLayout, size, handle);
+    return LookupStBuf(&stVtxLayout, size, handle);
+}
+void StatGrState(PSTBUFSTAT stat)
+{
+    *stat = stGrState.stat;
+}
+void StatVtxLayout(PSTBUFSTAT stat)
+{
+    *stat = stVtxLayout.stat;
 }
 int FreeGrState(void)
 {
-    return FreeStBuf(&llGrState);
+    return FreeStBuf(&stGrState);
 }
 int FreeVtxLayout(void)
 {
-    return FreeStBuf(&llVtxLayout);
+    return FreeStBuf(&stVtxLayout);
 }
-
@@ -21,8 +21,15 @@
 #ifndef _SV_TRCKR_H
 #define _SV_TRCKR_H
 
+typedef struct {
+    uint32_t hit;
+    uint32_t miss;
+} STBUFSTAT, * PSTBUFSTAT;
+
 void *LookupGrState(uint32_t handle, int size);
 void *LookupVtxLayout(uint32_t handle, int size);
+void StatGrState(PSTBUFSTAT stat);
+void StatVtxLayout(PSTBUFSTAT stat);
 int FreeGrState(void);
 int FreeVtxLayout(void);
 
@@ -0,0 +1,292 @@
+/*
+ * QEMU 3Dfx Glide Pass-Through
+ *
+ *  Copyright (c) 2018-2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitops.h"
+#include "qemu/interval-tree.h"
+
+#include "glide2x_impl.h"
+
+/*
+ * Texture download cache. Every download is recorded against the TMU
+ * address range it may write, keyed by the download parameters and a
+ * hash of the texels. A repeat download of identical content to the same
+ * address is dropped, any other download evicts the records it overlaps.
+ * guTex* downloads address texture memory through mmid handles, so they
+ * are kept in a namespace of their own and a miss on either side evicts
+ * the other wholesale.
+ */
+#define TEXCACHE_TMU_MAX    3
+#define TEXCACHE_GU         TEXCACHE_TMU_MAX
+#define TEXCACHE_MAX        8192
+#define TEXCACHE_GU_LOD     32
+#define TEXCACHE_TABLE_MAX  3
+
+#define TEXHASH_PRIME1      0x9E3779B185EBCA87ULL
+#define TEXHASH_PRIME2      0xC2B2AE3D27D4EB4FULL
+#define TEXHASH_PRIME3      0x165667B19E3779F9ULL
+
+typedef struct {
+    IntervalTreeNode range;
+    uint32_t key[6];
+    uint32_t size;
+    uint64_t hash;
+} TEXENTRY, * PTEXENTRY;
+
+typedef struct {
+    uint32_t type;
+    uint8_t data[SIZE_GUTEXPALETTE];
+} TEXTABLE;
+
+static struct {
+    IntervalTreeRoot root[TEXCACHE_TMU_MAX + 1];
+    int cnt[TEXCACHE_TMU_MAX + 1];
+    TEXTABLE table[TEXCACHE_TMU_MAX][TEXCACHE_TABLE_MAX];
+    TEXCACHESTAT stat;
+} texCache;
+
+static uint64_t TexHash(const uint8_t *data, const uint32_t size)
+{
+    uint64_t h = TEXHASH_PRIME3 ^ size, w;
+    uint32_t i;
+
+    for (i = 0; (i + sizeof(uint64_t)) <= size; i += sizeof(uint64_t)) {
+        memcpy(&w, data + i, sizeof(uint64_t));
+        h = rol64(h ^ (w * TEXHASH_PRIME2), 31) * TEXHASH_PRIME1;
+    }
+    for (; i < size; i++)
+        h = rol64(h ^ (data[i] * TEXHASH_PRIME3), 11) * TEXHASH_PRIME1;
+    h ^= h >> 33;
+    h *= TEXHASH_PRIME2;
+    h ^= h >> 29;
+    return h;
+}
+
+static void TexCacheEvict(const int ns, const uint64_t lo, const uint64_t hi)
+{
+    IntervalTreeNode *n;
+
+    while ((n = interval_tree_iter_first(&texCache.root[ns], lo, hi))) {
+        interval_tree_remove(n, &texCache.root[ns]);
+        g_free(container_of(n, TEXENTRY, range));
+        texCache.cnt[ns]--;
+        texCache.stat.evict++;
+    }
+}
+
+static void TexCacheEvictAll(const int ns)
+{
+    TexCacheEvict(ns, 0, UINT64_MAX);
+}
+
+static void TexTableFlush(void)
+{
+    memset(texCache.table, 0, sizeof(texCache.table));
+}
+
+void TexCacheFlush(void)
+{
+    for (int i = 0; i <= TEXCACHE_TMU_MAX; i++)
+        TexCacheEvictAll(i);
+    TexTableFlush();
+}
+
+/*
+ * Shadow of the last palette/NCC table downloaded to each TMU. Host
+ * wrappers re-expand every palettized or YIQ texture bound after a table
+ * download, so re-sending an unchanged table is dropped here. Partial
+ * palette downloads only compare and update entries start to end.
+ */
+static int TexTableLookup(const uint32_t tmu, const uint32_t type, const uint8_t *data,
+                          const uint32_t start, const uint32_t end)
+{
+    TEXTABLE *t;
+    uint32_t offs, size;
+
+    if ((tmu >= TEXCACHE_TMU_MAX) || (start > end) || (end >= (SIZE_GUTEXPALETTE / sizeof(uint32_t)))) {
+        TexTableFlush();
+        return 0;
+    }
+    t = &texCache.table[tmu][MIN(type, GR_TEXTABLE_PALETTE)];
+    offs = (type >= GR_TEXTABLE_PALETTE)? (start * sizeof(uint32_t)):0;
+    size = (type >= GR_TEXTABLE_PALETTE)? ((end - start + 1) * sizeof(uint32_t)):SIZE_GUNCCTABLE;
+    if ((t->type == (type + 1)) && !memcmp(t->data + offs, data + offs, size)) {
+        texCache.stat.tblHit++;
+        return 1;
+    }
+
+    texCache.stat.tblMiss++;
+    if (t->type != (type + 1)) {
+        if ((type >= GR_TEXTABLE_PALETTE) && (size != SIZE_GUTEXPALETTE)) {
+            /* partial download over unknown entries, shadow stays invalid */
+            t->type = 0;
+            return 0;
+        }
+        t->type = type + 1;
+    }
+    memcpy(t->data + offs, data + offs, size);
+    return 0;
+}
+
+static int TexCacheLookup(int ns, const uint64_t lo, const uint64_t hi, const uint32_t *key,
+                          const uint8_t *data, const uint32_t size)
+{
+    uint64_t hash = TexHash(data, size);
+    IntervalTreeNode *n;
+    PTEXENTRY p;
+
+    for (n = interval_tree_iter_first(&texCache.root[ns], lo, hi); n;
+         n = interval_tree_iter_next(n, lo, hi)) {
+        p = container_of(n, TEXENTRY, range);
+        if ((n->start == lo) && (n->last == hi) && (p->size == size) &&
+            (p->hash == hash) && !memcmp(p->key, key, sizeof(p->key))) {
+            texCache.stat.hit++;
+            texCache.stat.skip += size;
+            return 1;
+        }
+    }
+
+    texCache.stat.miss++;
+    TexCacheEvict(ns, lo, hi);
+    for (int i = 0; i <= TEXCACHE_TMU_MAX; i++) {
+        if ((ns == TEXCACHE_GU) ^ (i == TEXCACHE_GU))
+            TexCacheEvictAll(i);
+    }
+    if (texCache.cnt[ns] >= TEXCACHE_MAX)
+        TexCacheEvictAll(ns);
+    p = g_new0(TEXENTRY, 1);
+    p->range.start = lo;
+    p->range.last = hi;
+    memcpy(p->key, key, sizeof(p->key));
+    p->size = size;
+    p->hash = hash;
+    interval_tree_insert(&p->range, &texCache.root[ns]);
+    texCache.cnt[ns]++;
+    return 0;
+}
+
+/*
+ * Offset of one mipmap level within the chain starting at largeLod. LOD
+ * numbering runs small-to-large on Glide2 and large-to-small on Glide3,
+ * split even/odd chains fall back to the whole chain.
+ */
+static uint32_t TexCacheLevelOffs(const uint32_t *arg)
+{
+    uint32_t prev;
+
+    if ((arg[6] != GR_MIPMAPLEVELMASK_BOTH) || (arg[2] == arg[3]))
+        return 0;
+    prev = (arg[3] < arg[2])? (arg[2] - 1):(arg[2] + 1);
+    return wrTexCalcMem(prev, arg[3], arg[4], arg[5]);
+}
+
+int TexCacheHit(const int FEnum, const uint32_t *arg, const uintptr_t *parg)
+{
+    uint32_t key[6], tmu = arg[0], foot, offs;
+    const wrTexInfo *info;
+
+    switch (FEnum) {
+        /* texture memory written by anything but a download */
+        case FEnum_grSstWinOpen:
+        case FEnum_grSstWinOpenExt:
+            memset(&texCache.stat, 0, sizeof(TEXCACHESTAT));
+            /* fall through */
+        case FEnum_grTextureBufferExt:
+        case FEnum_grTextureAuxBufferExt:
+        case FEnum_grSstSelect:
+        case FEnum_guTexMemReset:
+        case FEnum_grSstWinClose:
+        case FEnum_grSstWinClose3x:
+        case FEnum_grGlideShutdown:
+            TexCacheFlush();
+            return 0;
+        /* tables downloaded behind our back by the gu utility layer */
+        case FEnum_guTexSource:
+        case FEnum_guTexDownloadMipMap:
+        case FEnum_grGlideSetState:
+            TexTableFlush();
+            break;
+        default:
+            break;
+    }
+    if (!glide_texcache())
+        return 0;
+
+    switch (FEnum) {
+        case FEnum_grTexDownloadMipMap:
+            info = (const wrTexInfo *)parg[3];
+            foot = wrTexCalcMem(info->small, info->large, info->aspect, info->format);
+            if (!foot || (tmu >= TEXCACHE_TMU_MAX))
+                break;
+            key[0] = FEnum; key[1] = arg[2];
+            key[2] = info->small; key[3] = info->large;
+            key[4] = info->aspect; key[5] = info->format;
+            return TexCacheLookup(tmu, arg[1], (uint64_t)arg[1] + foot - 1, key,
+                info->data, arg[4]);
+        case FEnum_grTexDownloadMipMapLevel:
+        case FEnum_grTexDownloadMipMapLevelPartial:
+            foot = wrTexCalcMem(arg[2], arg[3], arg[4], arg[5]);
+            if (!foot || (tmu >= TEXCACHE_TMU_MAX))
+                break;
+            offs = TexCacheLevelOffs(arg);
+            offs = (offs < foot)? offs:0;
+            key[0] = FEnum; key[1] = arg[6];
+            key[2] = arg[2]; key[3] = arg[3];
+            key[4] = (arg[4] << 16) | arg[5];
+            key[5] = (FEnum == FEnum_grTexDownloadMipMapLevelPartial)? ((arg[8] << 16) | arg[9]):0;
+            return TexCacheLookup(tmu, (uint64_t)arg[1] + offs, (uint64_t)arg[1] + foot - 1, key,
+                (const uint8_t *)parg[3], (FEnum == FEnum_grTexDownloadMipMapLevel)? arg[8]:arg[10]);
+        case FEnum_guTexDownloadMipMap:
+            key[0] = FEnum; key[1] = arg[0];
+            key[2] = (parg[2])? TexHash((const uint8_t *)parg[2], SIZE_GUNCCTABLE):0;
+            key[3] = key[4] = key[5] = 0;
+            return TexCacheLookup(TEXCACHE_GU, (uint64_t)arg[0] * TEXCACHE_GU_LOD,
+                ((uint64_t)arg[0] * TEXCACHE_GU_LOD) + TEXCACHE_GU_LOD - 1, key,
+                (const uint8_t *)parg[1], arg[3]);
+        case FEnum_guTexDownloadMipMapLevel:
+            key[0] = FEnum; key[1] = arg[0]; key[2] = arg[1];
+            key[3] = key[4] = key[5] = 0;
+            return TexCacheLookup(TEXCACHE_GU, ((uint64_t)arg[0] * TEXCACHE_GU_LOD) + (arg[1] & (TEXCACHE_GU_LOD - 1)),
+                ((uint64_t)arg[0] * TEXCACHE_GU_LOD) + (arg[1] & (TEXCACHE_GU_LOD - 1)), key,
+                *(const uint8_t **)parg[2], arg[3]);
+        case FEnum_grTexDownloadTable:
+            return TexTableLookup(arg[0], arg[1], (const uint8_t *)parg[2],
+                0, (SIZE_GUTEXPALETTE / sizeof(uint32_t)) - 1);
+        case FEnum_grTexDownloadTablePartial:
+            return TexTableLookup(arg[0], arg[1], (const uint8_t *)parg[2], arg[3], arg[4]);
+        case FEnum_grTexDownloadTable3x:
+            return TexTableLookup(0, arg[0], (const uint8_t *)parg[1],
+                0, (SIZE_GUTEXPALETTE / sizeof(uint32_t)) - 1);
+        case FEnum_grTexDownloadTablePartial3x:
+            return TexTableLookup(0, arg[0], (const uint8_t *)parg[1], arg[2], arg[3]);
+        default:
+            return 0;
+    }
+
+    /* download of unknown extent, nothing on this TMU can be trusted */
+    TexCacheEvictAll((tmu < TEXCACHE_TMU_MAX)? tmu:0);
+    TexCacheEvictAll(TEXCACHE_GU);
+    return 0;
+}
+
+void StatTexCache(PTEXCACHESTAT stat)
+{
+    memcpy(stat, &texCache.stat, sizeof(TEXCACHESTAT));
+}
@@ -0,0 +1,37 @@
+/*
+ * QEMU 3Dfx Glide Pass-Through
+ *
+ *  Copyright (c) 2018-2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GL_TEXCACHE_H
+#define _GL_TEXCACHE_H
+
+typedef struct {
+    uint32_t hit;
+    uint32_t miss;
+    uint32_t evict;
+    uint64_t skip;
+    uint32_t tblHit;
+    uint32_t tblMiss;
+} TEXCACHESTAT, * PTEXCACHESTAT;
+
+int TexCacheHit(const int, const uint32_t *, const uintptr_t *);
+void TexCacheFlush(void);
+void StatTexCache(PTEXCACHESTAT);
+
+#endif //_GL_TEXCACHE_H
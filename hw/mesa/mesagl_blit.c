@@ -22,11 +22,26 @@
 
 #include "mesagl_impl.h"
 
-int mesa_gui_fullscreen(const void *);
+#define SCALER_NEAREST  0
+#define SCALER_BILINEAR 1
+#define SCALER_SHARP    2
+#define SCALER_INTEGER  3
 
+/*
+ * The scaler objects are named in the guest context. Buffer, vertex array
+ * and framebuffer names must come from glGen* there, but legacy titles
+ * bind hardcoded texture names, so the copy of the window that needs a
+ * texture (sharp-bilinear, sRGB correction, MSAA window) is still generated
+ * and deleted per frame. The other cases copy into a persistent
+ * renderbuffer FBO and blit back scaled.
+ */
 static struct {
-    unsigned vao, vbo;
+    unsigned vao, vbo, fbo, rbo;
     int prog, vert, frag, black;
+    int sharp, texsize, prescale;
+    int fbo_w, fbo_h;
+    int coord_sz;
+    float coord[32];
     int adj, flip;
 } blit;
 static unsigned blit_program_setup(void)
@@ -63,23 +78,43 @@ static unsigned blit_program_setup(void)
         "#version 120\n"
         "uniform sampler2D screen_texture;\n"
         "uniform bool frag_just_black;\n"
+        "uniform bool frag_sharp;\n"
+        "uniform vec2 tex_size;\n"
+        "uniform vec2 prescale;\n"
         "varying vec2 texcoord;\n"
+        "vec2 sharp_coord(vec2 tc) {\n"
+        "  vec2 texel = tc * tex_size;\n"
+        "  vec2 region = 0.5 - 0.5 / prescale;\n"
+        "  vec2 dist = fract(texel) - 0.5;\n"
+        "  vec2 f = (dist - clamp(dist, -region, region)) * prescale + 0.5;\n"
+        "  return (floor(texel) + f) / tex_size;\n"
+        "}\n"
         "void main() {\n"
         "  if (frag_just_black)\n"
         "    gl_FragColor = vec4(0,0,0,1);\n"
         "  else\n"
-        "    gl_FragColor = texture2D(screen_texture, texcoord);\n"
+        "    gl_FragColor = texture2D(screen_texture, (frag_sharp)? sharp_coord(texcoord):texcoord);\n"
         "}\n",
         "#version 140\n"
         "uniform sampler2D screen_texture;\n"
         "uniform bool frag_just_black;\n"
+        "uniform bool frag_sharp;\n"
+        "uniform vec2 tex_size;\n"
+        "uniform vec2 prescale;\n"
         "in vec2 texcoord;\n"
         "out vec4 fragColor;\n"
+        "vec2 sharp_coord(vec2 tc) {\n"
+        "  vec2 texel = tc * tex_size;\n"
+        "  vec2 region = 0.5 - 0.5 / prescale;\n"
+        "  vec2 dist = fract(texel) - 0.5;\n"
+        "  vec2 f = (dist - clamp(dist, -region, region)) * prescale + 0.5;\n"
+        "  return (floor(texel) + f) / tex_size;\n"
+        "}\n"
         "void main() {\n"
         "  if (frag_just_black)\n"
         "    fragColor = vec4(0,0,0,1);\n"
         "  else\n"
-        "    fragColor = texture(screen_texture, texcoord);\n"
+        "    fragColor = texture(screen_texture, (frag_sharp)? sharp_coord(texcoord):texcoord);\n"
         "}\n"
     };
     int prog;
@@ -112,14 +147,19 @@ static unsigned blit_program_setup(void)
     PFN_CALL(glGetIntegerv(GL_CURRENT_PROGRAM, &prog));
     PFN_CALL(glUseProgram(blit.prog));
     blit.black = PFN_CALL(glGetUniformLocation(blit.prog, "frag_just_black"));
+    blit.sharp = PFN_CALL(glGetUniformLocation(blit.prog, "frag_sharp"));
+    blit.texsize = PFN_CALL(glGetUniformLocation(blit.prog, "tex_size"));
+    blit.prescale = PFN_CALL(glGetUniformLocation(blit.prog, "prescale"));
     return prog;
 }
 void MesaBlitFree(void)
 {
-    MESA_PFN(PFNGLDELETEBUFFERSPROC,      glDeleteBuffers);
-    MESA_PFN(PFNGLDELETEPROGRAMPROC,      glDeleteProgram);
-    MESA_PFN(PFNGLDELETESHADERPROC,       glDeleteShader);
-    MESA_PFN(PFNGLDELETEVERTEXARRAYSPROC, glDeleteVertexArrays);
+    MESA_PFN(PFNGLDELETEBUFFERSPROC,       glDeleteBuffers);
+    MESA_PFN(PFNGLDELETEFRAMEBUFFERSPROC,  glDeleteFramebuffers);
+    MESA_PFN(PFNGLDELETEPROGRAMPROC,       glDeleteProgram);
+    MESA_PFN(PFNGLDELETERENDERBUFFERSPROC, glDeleteRenderbuffers);
+    MESA_PFN(PFNGLDELETESHADERPROC,        glDeleteShader);
+    MESA_PFN(PFNGLDELETEVERTEXARRAYSPROC,  glDeleteVertexArrays);
     if (blit.prog) {
         PFN_CALL(glDeleteProgram(blit.prog));
         PFN_CALL(glDeleteShader(blit.vert));
@@ -129,6 +169,10 @@ void MesaBlitFree(void)
         PFN_CALL(glDeleteBuffers(1, &blit.vbo));
     if (blit.vao)
         PFN_CALL(glDeleteVertexArrays(1, &blit.vao));
+    if (blit.fbo)
+        PFN_CALL(glDeleteFramebuffers(1, &blit.fbo));
+    if (blit.rbo)
+        PFN_CALL(glDeleteRenderbuffers(1, &blit.rbo));
     memset(&blit, 0, sizeof(blit));
 }
 struct save_states {
@@ -188,10 +232,17 @@ static int blit_program_buffer(void *save_map, const int size, const void *data)
             PFN_CALL(glGenVertexArrays(1, &blit.vao));
         PFN_CALL(glBindVertexArray(blit.vao));
     }
-    if (!blit.vbo)
+    if (!blit.vbo) {
         PFN_CALL(glGenBuffers(1, &blit.vbo));
+        blit.coord_sz = 0;
+    }
     PFN_CALL(glBindBuffer(GL_ARRAY_BUFFER, blit.vbo));
-    PFN_CALL(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
+    if ((size != blit.coord_sz) || memcmp(blit.coord, data, size)) {
+        PFN_CALL(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
+        blit.coord_sz = (size > sizeof(blit.coord))? 0:size;
+        if (blit.coord_sz)
+            memcpy(blit.coord, data, size);
+    }
     return 0;
 }
 static void blit_restore_savemap(const void *save_map)
@@ -215,9 +266,41 @@ static void blit_restore_savemap(const void *save_map)
             PFN_CALL(glEnable(boolean_states[i]));
     }
 }
+static int blit_fbo_setup(const int w, const int h)
+{
+    MESA_PFN(PFNGLBINDFRAMEBUFFERPROC,         glBindFramebuffer);
+    MESA_PFN(PFNGLBINDRENDERBUFFERPROC,        glBindRenderbuffer);
+    MESA_PFN(PFNGLFRAMEBUFFERRENDERBUFFERPROC, glFramebufferRenderbuffer);
+    MESA_PFN(PFNGLGENFRAMEBUFFERSPROC,         glGenFramebuffers);
+    MESA_PFN(PFNGLGENRENDERBUFFERSPROC,        glGenRenderbuffers);
+    MESA_PFN(PFNGLGETINTEGERVPROC,             glGetIntegerv);
+    MESA_PFN(PFNGLRENDERBUFFERSTORAGEPROC,     glRenderbufferStorage);
+    int last_rbo;
+
+    if (!p_glGenFramebuffers || !p_glGenRenderbuffers)
+        return 0;
+    if (!blit.fbo) {
+        PFN_CALL(glGenFramebuffers(1, &blit.fbo));
+        PFN_CALL(glGenRenderbuffers(1, &blit.rbo));
+        blit.fbo_w = blit.fbo_h = 0;
+    }
+    if ((blit.fbo_w != w) || (blit.fbo_h != h)) {
+        PFN_CALL(glGetIntegerv(GL_RENDERBUFFER_BINDING, &last_rbo));
+        PFN_CALL(glBindRenderbuffer(GL_RENDERBUFFER, blit.rbo));
+        PFN_CALL(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h));
+        PFN_CALL(glBindRenderbuffer(GL_RENDERBUFFER, last_rbo));
+        PFN_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, blit.fbo));
+        PFN_CALL(glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_RENDERBUFFER, blit.rbo));
+        blit.fbo_w = w;
+        blit.fbo_h = h;
+    }
+    return 1;
+}
 void MesaBlitScale(void)
 {
     MESA_PFN(PFNGLACTIVETEXTUREPROC,            glActiveTexture);
+    MESA_PFN(PFNGLBINDFRAMEBUFFERPROC,          glBindFramebuffer);
     MESA_PFN(PFNGLBINDTEXTUREPROC,              glBindTexture);
     MESA_PFN(PFNGLBLITFRAMEBUFFERPROC,          glBlitFramebuffer);
     MESA_PFN(PFNGLCOPYTEXIMAGE2DPROC,           glCopyTexImage2D);
@@ -229,11 +312,12 @@ void MesaBlitScale(void)
     MESA_PFN(PFNGLGENTEXTURESPROC,              glGenTextures);
     MESA_PFN(PFNGLTEXPARAMETERIPROC,            glTexParameteri);
     MESA_PFN(PFNGLUNIFORM1IPROC,                glUniform1i);
+    MESA_PFN(PFNGLUNIFORM2FPROC,                glUniform2f);
     MESA_PFN(PFNGLUSEPROGRAMPROC,               glUseProgram);
     MESA_PFN(PFNGLVERTEXATTRIBPOINTERPROC,      glVertexAttribPointer);
     MESA_PFN(PFNGLVIEWPORTPROC,                 glViewport);
 
-    int v[4], fullscreen = mesa_gui_fullscreen(v);
+    int v[4], fullscreen = MGLGuiFullscreen(v);
 
     if (blit.adj) {
         blit.adj = !blit.adj;
@@ -243,10 +327,14 @@ void MesaBlitScale(void)
 
     if (DrawableContext() && ((!fullscreen && (v[3] > (v[1] & 0x7FFFU)))
             || RenderScalerOff())) {
-        unsigned screen_texture, w = v[0], h = v[1] & 0x7FFFU,
+        unsigned w = v[0], h = v[1] & 0x7FFFU,
                 last_prog = blit_program_setup();
         int aspect = (v[1] & (1 << 15))? 0:1,
-                offs_x = v[2] - ((v[0] * 1.f * v[3]) / (v[1] & 0x7FFFU));
+                offs_x = v[2] - ((v[0] * 1.f * v[3]) / (v[1] & 0x7FFFU)),
+                filter = ScalerFilter(),
+                int_s = MAX(1, MIN(v[2] / w, v[3] / h)),
+                int_w = w * int_s, int_h = h * int_s,
+                int_x = (v[2] - int_w) >> 1, int_y = (v[3] - int_h) >> 1;
         offs_x >>= 1;
         v[0] *= (1.f * v[3]) / (v[1] & 0x7FFFU);
         v[1] = v[3];
@@ -261,43 +349,88 @@ void MesaBlitScale(void)
         struct save_states save_map;
 
         if (!blit_program_buffer(&save_map, sizeof(coord), coord)) {
+            int fmt = (FRAMEBUFFER_SRGB_(save_map) && ScalerSRGBCorr())? GL_SRGB:GL_RGBA,
+                blit_filter = ((filter == SCALER_BILINEAR) || (filter == SCALER_SHARP))?
+                    GL_LINEAR:GL_NEAREST;
             PFN_CALL(glUniform1i(blit.black, GL_TRUE));
             PFN_CALL(glViewport(0,0,  v[2], v[3]));
             PFN_CALL(glEnableVertexAttribArray(0));
             PFN_CALL(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0));
-            if (save_map.read_binding == save_map.draw_binding) {
+            if ((save_map.read_binding == save_map.draw_binding) &&
+                    (filter != SCALER_SHARP) && (fmt == GL_RGBA) && !GetContextMSAA() &&
+                    blit_fbo_setup(w, h)) {
+                int dst[4];
+                PFN_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, blit.fbo));
+                PFN_CALL(glBlitFramebuffer(0,0,w,h, 0,0,w,h, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+                PFN_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, save_map.draw_binding));
+                if (filter == SCALER_INTEGER) {
+                    PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 8, 4)); /* clear */
+                    dst[0] = int_x; dst[1] = int_y; dst[2] = int_x + int_w; dst[3] = int_y + int_h;
+                }
+                else if (aspect) {
+                    PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4)); /* clear */
+                    PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 4, 4)); /* clear */
+                    dst[0] = offs_x; dst[1] = 0; dst[2] = v[0] + offs_x; dst[3] = v[1];
+                }
+                else {
+                    dst[0] = 0; dst[1] = 0; dst[2] = v[2]; dst[3] = v[3];
+                }
+                PFN_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, blit.fbo));
+                PFN_CALL(glBlitFramebuffer(0,0,w,h, dst[0],(blit.flip)? dst[3]:dst[1],
+                    dst[2],(blit.flip)? dst[1]:dst[3], GL_COLOR_BUFFER_BIT, blit_filter));
+                PFN_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, save_map.read_binding));
+            }
+            else if (save_map.read_binding == save_map.draw_binding) {
+                unsigned screen_texture;
                 PFN_CALL(glActiveTexture(GL_TEXTURE0));
                 PFN_CALL(glGenTextures(1, &screen_texture));
                 PFN_CALL(glBindTexture(GL_TEXTURE_2D, screen_texture));
-                PFN_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-                PFN_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-                PFN_CALL(glCopyTexImage2D(GL_TEXTURE_2D, 0, (FRAMEBUFFER_SRGB_(save_map) && ScalerSRGBCorr())?
-                            GL_SRGB:GL_RGBA, 0,0, w,h, 0));
-                if (aspect) {
+                PFN_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, blit_filter));
+                PFN_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, blit_filter));
+                PFN_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+                PFN_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+                PFN_CALL(glCopyTexImage2D(GL_TEXTURE_2D, 0, fmt, 0,0, w,h, 0));
+                if (filter == SCALER_INTEGER) {
+                    PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 8, 4)); /* clear */
+                    PFN_CALL(glViewport(int_x,int_y,  int_w,int_h));
+                }
+                else if (aspect) {
                     PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4)); /* clear */
                     PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 4, 4)); /* clear */
                     PFN_CALL(glViewport(offs_x,0,  v[0],v[1]));
                 }
                 PFN_CALL(glUniform1i(blit.black, GL_FALSE));
+                PFN_CALL(glUniform1i(blit.sharp, (filter == SCALER_SHARP)? GL_TRUE:GL_FALSE));
+                if (filter == SCALER_SHARP) {
+                    int dst_w = (aspect)? v[0]:v[2];
+                    PFN_CALL(glUniform2f(blit.texsize, w, h));
+                    PFN_CALL(glUniform2f(blit.prescale, MAX(1, dst_w / w), MAX(1, v[1] / h)));
+                }
                 PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 8, 4)); /* scale */
                 PFN_CALL(glDeleteTextures(1, &screen_texture));
                 PFN_CALL(glActiveTexture(save_map.texture));
                 PFN_CALL(glBindTexture(GL_TEXTURE_2D, save_map.texture_binding));
             }
             else {
+                /* Linear blits are limited to color buffer */
+                int mask = (filter == SCALER_NEAREST)?
+                    (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT):GL_COLOR_BUFFER_BIT;
                 if (FRAMEBUFFER_SRGB_(save_map))
                     PFN_CALL(glEnable(boolean_states[0]));
-                if (aspect) {
+                if (filter == SCALER_INTEGER) {
+                    PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 8, 4)); /* clear */
+                    PFN_CALL(glBlitFramebuffer(0,0,w,h, int_x,int_y + int_h,int_x + int_w,int_y,
+                        mask, blit_filter));
+                }
+                else if (aspect) {
                     PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4)); /* clear */
                     PFN_CALL(glDrawArrays(GL_TRIANGLE_STRIP, 4, 4)); /* clear */
                     PFN_CALL(glBlitFramebuffer(0,0,w,h, offs_x,v[1],v[0]+offs_x,0,
-                        (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT),
-                        GL_NEAREST));
+                        mask, blit_filter));
                 }
                 else
                     PFN_CALL(glBlitFramebuffer(0,0,w,h, 0,v[3],v[2],0,
-                        (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT),
-                        GL_NEAREST));
+                        mask, blit_filter));
             }
             PFN_CALL(glDisableVertexAttribArray(0));
             PFN_CALL(glViewport(save_map.view[0], save_map.view[1],
@@ -314,8 +447,10 @@ void MesaRenderScaler(const uint32_t FEnum, void *args)
     int v[4], fullscreen, framebuffer_binding, aspect, blit_adj = 0;
     uint32_t *box;
 
-    PFN_CALL(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer_binding));
-    fullscreen = mesa_gui_fullscreen(v);
+    framebuffer_binding = MGLStateFramebuffer();
+    if (framebuffer_binding < 0)
+        PFN_CALL(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer_binding));
+    fullscreen = MGLGuiFullscreen(v);
     aspect = (v[1] & (1 << 15))? 0:1;
 
     switch(FEnum) {
@@ -19,6 +19,7 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/timer.h"
 #include "hw/hw.h"
 
 #include "mesagl_impl.h"
@@ -52,7 +53,12 @@ static int getNumArgs(const char *sym)
 
 int GLFEnumArgsCnt(const int FEnum)
 {
-    return getNumArgs(tblMesaGL[FEnum].sym);
+    return tblMesaGL[FEnum].nargs;
+}
+
+const char *GLFEnumFuncSym(const int FEnum)
+{
+    return tblMesaGL[FEnum].sym;
 }
 
 void * GLFEnumFuncPtr(const int FEnum)
@@ -175,6 +181,309 @@ void wrFlushBufObj(uint32_t target, mapbufo_t *bufo)
     }
 }
 
+#define MAX_RPBO_RING 4
+static struct {
+    unsigned pbo[MAX_RPBO_RING];
+    GLsync fence[MAX_RPBO_RING];
+    uint32_t key[MAX_RPBO_RING][10];
+    int size[MAX_RPBO_RING], cap[MAX_RPBO_RING];
+    int head, cnt;
+} rpbo;
+
+static void wrReadPixelsRingReset(void)
+{
+    memset(&rpbo, 0, sizeof(rpbo));
+}
+
+static void wrReadPixelsRingFree(void)
+{
+    MESA_PFN(PFNGLDELETEBUFFERSPROC,   glDeleteBuffers);
+    MESA_PFN(PFNGLDELETESYNCPROC,      glDeleteSync);
+
+    for (int i = 0; i < MAX_RPBO_RING; i++) {
+        if (rpbo.fence[i])
+            PFN_CALL(glDeleteSync(rpbo.fence[i]));
+        if (rpbo.pbo[i])
+            PFN_CALL(glDeleteBuffers(1, &rpbo.pbo[i]));
+    }
+    wrReadPixelsRingReset();
+}
+
+int wrReadPixelsRing(uint32_t *arg, void *dst)
+{
+    MESA_PFN(PFNGLBINDBUFFERPROC,      glBindBuffer);
+    MESA_PFN(PFNGLBUFFERDATAPROC,      glBufferData);
+    MESA_PFN(PFNGLCLIENTWAITSYNCPROC,  glClientWaitSync);
+    MESA_PFN(PFNGLDELETESYNCPROC,      glDeleteSync);
+    MESA_PFN(PFNGLFENCESYNCPROC,       glFenceSync);
+    MESA_PFN(PFNGLGENBUFFERSPROC,      glGenBuffers);
+    MESA_PFN(PFNGLMAPBUFFERRANGEPROC,  glMapBufferRange);
+    MESA_PFN(PFNGLREADPIXELSPROC,      glReadPixels);
+    MESA_PFN(PFNGLUNMAPBUFFERPROC,     glUnmapBuffer);
+    int depth = GLReadPixelsPBO(), pack, align, rowlen, skipPix, skipRows, bpp, pitch, size, slot, last;
+    void *src;
+
+    if (!depth || !PFN_CALL(glFenceSync) || !PFN_CALL(glMapBufferRange))
+        return 0;
+    pack = MGLStateInt(GL_PIXEL_PACK_BUFFER_BINDING);
+    if (pack)
+        return 0;
+
+    bpp = szgldata(arg[4], arg[5]);
+    align = MGLStateInt(GL_PACK_ALIGNMENT);
+    rowlen = MGLStateInt(GL_PACK_ROW_LENGTH);
+    skipPix = MGLStateInt(GL_PACK_SKIP_PIXELS);
+    skipRows = MGLStateInt(GL_PACK_SKIP_ROWS);
+    pitch = ROUND_UP(((rowlen)? rowlen:arg[2]) * bpp, (align)? align:1);
+    size = ((skipRows + arg[3] - 1) * pitch) + ((skipPix + arg[2]) * bpp);
+    if (!bpp || !arg[2] || !arg[3] || (size > MGLFBT_SIZE))
+        return 0;
+
+    slot = rpbo.head;
+    if (!rpbo.pbo[slot])
+        PFN_CALL(glGenBuffers(1, &rpbo.pbo[slot]));
+    PFN_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, rpbo.pbo[slot]));
+    if (size > rpbo.cap[slot]) {
+        PFN_CALL(glBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_STREAM_READ));
+        rpbo.cap[slot] = size;
+    }
+    PFN_CALL(glReadPixels(arg[0], arg[1], arg[2], arg[3], arg[4], arg[5], 0));
+    if (rpbo.fence[slot])
+        PFN_CALL(glDeleteSync(rpbo.fence[slot]));
+    rpbo.fence[slot] = PFN_CALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    memcpy(rpbo.key[slot], arg, sizeof(uint32_t [6]));
+    rpbo.key[slot][6] = pitch;
+    rpbo.key[slot][7] = (skipRows << 16) | skipPix;
+    rpbo.key[slot][8] = MGLStateInt(GL_READ_FRAMEBUFFER_BINDING);
+    rpbo.key[slot][9] = MGLStateInt(GL_READ_BUFFER);
+    rpbo.size[slot] = size;
+    rpbo.head = (rpbo.head + 1) % depth;
+    rpbo.cnt = MIN(rpbo.cnt + 1, depth);
+
+    /* Hand back the oldest in-flight readback of the same region when
+     * the ring is primed, otherwise complete the one just issued */
+    last = rpbo.head;
+    if ((rpbo.cnt < depth) || memcmp(rpbo.key[last], rpbo.key[slot], sizeof(rpbo.key[slot])))
+        last = slot;
+    if (last != slot)
+        PFN_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, rpbo.pbo[last]));
+    while (PFN_CALL(glClientWaitSync(rpbo.fence[last], GL_SYNC_FLUSH_COMMANDS_BIT,
+                    1000000000)) == GL_TIMEOUT_EXPIRED);
+    src = PFN_CALL(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rpbo.size[last], GL_MAP_READ_BIT));
+    if (src) {
+        memcpy(dst, src, rpbo.size[last]);
+        PFN_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    PFN_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    return 1;
+}
+
+#ifndef GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD
+#define GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD 0x9160
+#endif
+#define MIN_TPIN_UPLOAD (1 << 16)
+#define MAX_TPIN_UPLOAD (1 << 23)
+#define MAX_TPIN_RING   4
+#define MAX_TPIN_CNTX   8
+
+/* Pinned staging slots of one host context, buffer names are not
+ * shared with pbuffer or level contexts */
+typedef struct {
+    uint32_t cntx;
+    unsigned buf[MAX_TPIN_RING];
+    void *mem[MAX_TPIN_RING];
+    GLsync fence[MAX_TPIN_RING];
+    uint32_t cap[MAX_TPIN_RING];
+    int head, slot;
+} TPINCNTX;
+
+static struct {
+    TPINCNTX cntx[MAX_TPIN_CNTX];
+    TPINCNTX *cur;
+    uint32_t curKey;
+    GSList *stale;
+    int state;
+    uint32_t calls, waits;
+    uint64_t bytes;
+} tpin;
+
+static void wrTexUnpackPinnedStale(TPINCNTX *c)
+{
+    for (int i = 0; i < MAX_TPIN_RING; i++) {
+        if (c->mem[i])
+            tpin.stale = g_slist_prepend(tpin.stale, c->mem[i]);
+    }
+    memset(c, 0, sizeof(TPINCNTX));
+}
+
+static void wrTexUnpackPinnedRelease(TPINCNTX *c)
+{
+    MESA_PFN(PFNGLCLIENTWAITSYNCPROC,  glClientWaitSync);
+    MESA_PFN(PFNGLDELETEBUFFERSPROC,   glDeleteBuffers);
+    MESA_PFN(PFNGLDELETESYNCPROC,      glDeleteSync);
+
+    for (int i = 0; i < MAX_TPIN_RING; i++) {
+        if (c->fence[i]) {
+            while (PFN_CALL(glClientWaitSync(c->fence[i], GL_SYNC_FLUSH_COMMANDS_BIT,
+                            1000000000)) == GL_TIMEOUT_EXPIRED);
+            PFN_CALL(glDeleteSync(c->fence[i]));
+        }
+        if (c->buf[i])
+            PFN_CALL(glDeleteBuffers(1, &c->buf[i]));
+        qemu_vfree(c->mem[i]);
+    }
+    memset(c, 0, sizeof(TPINCNTX));
+}
+
+static void wrTexUnpackPinnedReset(void)
+{
+    if (tpin.calls)
+        DPRINTF("TexZeroCopy uploads %u %" PRIu64 "MB slot waits %u",
+            tpin.calls, tpin.bytes >> 20, tpin.waits);
+    for (int i = 0; i < MAX_TPIN_CNTX; i++)
+        wrTexUnpackPinnedStale(&tpin.cntx[i]);
+    g_slist_free_full(tpin.stale, qemu_vfree);
+    memset(&tpin, 0, sizeof(tpin));
+}
+
+/* Called with the context being torn down still current, slots of
+ * other contexts go with their context and only the memory is kept
+ * until the next reset */
+static void wrTexUnpackPinnedFree(void)
+{
+    for (int i = 0; i < MAX_TPIN_CNTX; i++) {
+        if (!tpin.cntx[i].cntx)
+            continue;
+        if (tpin.cntx[i].cntx == tpin.curKey)
+            wrTexUnpackPinnedRelease(&tpin.cntx[i]);
+        else
+            wrTexUnpackPinnedStale(&tpin.cntx[i]);
+    }
+    tpin.cur = 0;
+}
+
+void wrTexUnpackPinnedCurrent(uint32_t cntx)
+{
+    tpin.curKey = cntx;
+    tpin.cur = 0;
+}
+
+void wrTexUnpackPinnedDrop(uint32_t cntx)
+{
+    for (int i = 0; cntx && (i < MAX_TPIN_CNTX); i++) {
+        if (tpin.cntx[i].cntx != cntx)
+            continue;
+        if (cntx == tpin.curKey)
+            wrTexUnpackPinnedRelease(&tpin.cntx[i]);
+        else
+            wrTexUnpackPinnedStale(&tpin.cntx[i]);
+    }
+    tpin.cur = 0;
+}
+
+static TPINCNTX *wrTexUnpackPinnedCntx(void)
+{
+    TPINCNTX *c = 0;
+
+    if (tpin.cur && (tpin.cur->cntx == tpin.curKey))
+        return tpin.cur;
+    for (int i = 0; i < MAX_TPIN_CNTX; i++) {
+        if (tpin.cntx[i].cntx == tpin.curKey)
+            return (tpin.cur = &tpin.cntx[i]);
+        c = (!c && !tpin.cntx[i].cntx)? &tpin.cntx[i]:c;
+    }
+    if (c)
+        c->cntx = tpin.curKey;
+    return (tpin.cur = c);
+}
+
+/* Stage large uploads through a ring of host buffers pinned with
+ * GL_AMD_pinned_memory, so the GPU sources texels without a driver
+ * staging copy. Only reusing a slot waits for its previous upload */
+int wrTexUnpackPinned(const void *src, const uint32_t len)
+{
+    MESA_PFN(PFNGLBINDBUFFERPROC,      glBindBuffer);
+    MESA_PFN(PFNGLBUFFERDATAPROC,      glBufferData);
+    MESA_PFN(PFNGLCLIENTWAITSYNCPROC,  glClientWaitSync);
+    MESA_PFN(PFNGLDELETEBUFFERSPROC,   glDeleteBuffers);
+    MESA_PFN(PFNGLDELETESYNCPROC,      glDeleteSync);
+    MESA_PFN(PFNGLFENCESYNCPROC,       glFenceSync);
+    MESA_PFN(PFNGLGENBUFFERSPROC,      glGenBuffers);
+    MESA_PFN(PFNGLGETBUFFERPARAMETERIVPROC, glGetBufferParameteriv);
+    MESA_PFN(PFNGLGETSTRINGPROC,       glGetString);
+    TPINCNTX *c;
+    int slot;
+
+    if (!GLTexZeroCopy() || (tpin.state < 0) || !tpin.curKey ||
+        (len < MIN_TPIN_UPLOAD) || (len > MAX_TPIN_UPLOAD))
+        return 0;
+    if (tpin.state == 0) {
+        const char *xstr = (const char *)PFN_CALL(glGetString(GL_EXTENSIONS));
+        tpin.state = -1;
+        if (!xstr || !strstr(xstr, "GL_AMD_pinned_memory") || !PFN_CALL(glFenceSync)) {
+            DPRINTF("TexZeroCopy unavailable, no GL_AMD_pinned_memory");
+            return 0;
+        }
+        tpin.state = 1;
+        DPRINTF("TexZeroCopy %d x pinned upload slots per context", MAX_TPIN_RING);
+    }
+    c = wrTexUnpackPinnedCntx();
+    if (!c)
+        return 0;
+
+    slot = c->head;
+    if (c->fence[slot]) {
+        while (PFN_CALL(glClientWaitSync(c->fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                        1000000000)) == GL_TIMEOUT_EXPIRED);
+        PFN_CALL(glDeleteSync(c->fence[slot]));
+        c->fence[slot] = 0;
+        tpin.waits++;
+    }
+    if (len > c->cap[slot]) {
+        int bufsz = 0;
+        if (c->buf[slot])
+            PFN_CALL(glDeleteBuffers(1, &c->buf[slot]));
+        qemu_vfree(c->mem[slot]);
+        c->cap[slot] = ROUND_UP(len, (1 << 20));
+        c->mem[slot] = qemu_memalign(qemu_real_host_page_size(), c->cap[slot]);
+        PFN_CALL(glGenBuffers(1, &c->buf[slot]));
+        PFN_CALL(glBindBuffer(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, c->buf[slot]));
+        PFN_CALL(glBufferData(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, c->cap[slot], c->mem[slot], GL_STREAM_DRAW));
+        PFN_CALL(glGetBufferParameteriv(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, GL_BUFFER_SIZE, &bufsz));
+        PFN_CALL(glBindBuffer(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, 0));
+        if (bufsz != c->cap[slot]) {
+            PFN_CALL(glDeleteBuffers(1, &c->buf[slot]));
+            qemu_vfree(c->mem[slot]);
+            c->buf[slot] = 0;
+            c->mem[slot] = 0;
+            c->cap[slot] = 0;
+            tpin.state = -1;
+            DPRINTF("TexZeroCopy pinning failed");
+            return 0;
+        }
+    }
+    memcpy(c->mem[slot], src, len);
+    PFN_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, c->buf[slot]));
+    c->slot = slot;
+    tpin.calls++;
+    tpin.bytes += len;
+    return 1;
+}
+
+/* Fence the slot just sourced, it is waited on when the ring wraps */
+void wrTexUnpackPinnedDone(void)
+{
+    MESA_PFN(PFNGLBINDBUFFERPROC,      glBindBuffer);
+    MESA_PFN(PFNGLFENCESYNCPROC,       glFenceSync);
+    TPINCNTX *c = tpin.cur;
+
+    PFN_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    if (!c)
+        return;
+    c->fence[c->slot] = PFN_CALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    c->head = (c->slot + 1) % MAX_TPIN_RING;
+}
+
 void wrContextSRGB(int use_srgb)
 {
     MESA_PFN(PFNGLENABLEPROC, glEnable);
@@ -219,7 +528,8 @@ const char *getGLFuncStr(int FEnum)
 
 void doMesaFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret)
 {
-    int numArgs = getNumArgs(tblMesaGL[FEnum].sym);
+    int numArgs = tblMesaGL[FEnum].nargs;
+    int64_t t0 = (GLFuncProfile())? get_clock():0;
 
     if (GLFuncTrace()) {
         const char *fstr = getGLFuncStr(FEnum);
@@ -228,6 +538,18 @@ void doMesaFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret)
         }
     }
 
+    if (MGLImmFunc(FEnum, arg, parg)) {
+        if (t0)
+            MGLProfileFunc(FEnum, get_clock() - t0);
+        return;
+    }
+
+    if (MGLStateQuery(FEnum, arg, parg, ret)) {
+        if (t0)
+            MGLProfileFunc(FEnum, get_clock() - t0);
+        return;
+    }
+
     /* Handle special GL funcs */
 #define GLDONE() \
     numArgs = -1; break
@@ -715,6 +1037,13 @@ void doMesaFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret)
             usfp.fpp1 = tblMesaGL[FEnum].ptr;
             *ret = (*usfp.fpp1)(parg[0], parg[1]);
             GLDONE();
+        case FEnum_glReadPixels:
+            if (wrReadPixelsRing(arg, (void *)parg[2])) {
+                GLDONE();
+            }
+            usfp.fpa5p6 = tblMesaGL[FEnum].ptr;
+            *ret = (*usfp.fpa5p6)(arg[0], arg[1], arg[2], arg[3], arg[4], arg[5], parg[2]);
+            GLDONE();
         case FEnum_glClearBufferSubData:
         case FEnum_glClearNamedBufferSubData:
         case FEnum_glClearNamedBufferSubDataEXT:
@@ -722,7 +1051,6 @@ void doMesaFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret)
         case FEnum_glCompressedTexImage1DARB:
         case FEnum_glCompressedTexSubImage1D:
         case FEnum_glCompressedTexSubImage1DARB:
-        case FEnum_glReadPixels:
         case FEnum_glTexSubImage1D:
         case FEnum_glTexSubImage1DEXT:
             usfp.fpa5p6 = tblMesaGL[FEnum].ptr;
@@ -877,6 +1205,12 @@ void doMesaFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret)
             usfp.fpa1p3 = tblMesaGL[FEnum].ptr;
             *ret = (*usfp.fpa1p3)(arg[0], arg[1], parg[2], parg[3]);
             GLDONE();
+        case FEnum_glLinkProgram:
+        case FEnum_glLinkProgramARB:
+            if (MGLShaderCacheLink(arg[0])) {
+                GLDONE();
+            }
+            break;
         case FEnum_glBufferData:
         case FEnum_glBufferDataARB:
         case FEnum_glBufferStorage:
@@ -1553,6 +1887,11 @@ void doMesaFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret)
 
     /* End - generated by hostgenfuncs */
 
+    MGLShaderCacheTrack(FEnum, arg, parg, *ret);
+    MGLStateTrack(FEnum, arg);
+    if (t0)
+        MGLProfileList(FEnum, arg, parg);
+
     if (GLCheckError()) {
         MESA_PFN(PFNGLGETERRORPROC, glGetError);
         static int begin_prim;
@@ -1592,12 +1931,15 @@ void doMesaFunc(int FEnum, uint32_t *arg, uintptr_t *parg, uintptr_t *ret)
             break;
         }
     }
+    if (t0)
+        MGLProfileFunc(FEnum, get_clock() - t0);
 }
 
 static int cfg_xYear;
 static int cfg_xLength;
 static int cfg_xWine;
 static int cfg_vertCacheMB;
+static int cfg_vertCacheHash;
 static int cfg_dispTimerMS;
 static int cfg_bufoAccelEN;
 static int cfg_cntxMSAA;
@@ -1605,23 +1947,42 @@ static int cfg_cntxSRGB;
 static int cfg_blitFlip;
 static int cfg_cntxVsyncOff;
 static int cfg_renderScalerOff;
+static int cfg_scalerFilter;
 static int cfg_fpsLimit;
+static int cfg_framePacing;
+static int cfg_renderThread;
+static int cfg_readPixelsPBO;
+static int cfg_texZeroCopy;
 static int cfg_shaderDump;
+static int cfg_shaderCache;
+static int cfg_stateShadow;
+static int cfg_immBatch;
 static int cfg_errorCheck;
 static int cfg_traceFifo;
 static int cfg_traceFunc;
+static int cfg_profFunc;
 static void conf_MGLOptions(void)
 {
     cfg_xYear = 0;
     cfg_xLength = 0;
     cfg_vertCacheMB = 32;
+    cfg_vertCacheHash = 0;
     cfg_cntxSRGB = 0;
     cfg_cntxVsyncOff = 0;
+    cfg_scalerFilter = 0;
     cfg_fpsLimit = 0;
+    cfg_framePacing = 0;
+    cfg_renderThread = 0;
+    cfg_readPixelsPBO = 0;
+    cfg_texZeroCopy = 0;
     cfg_shaderDump = 0;
+    cfg_shaderCache = 0;
+    cfg_stateShadow = 0;
+    cfg_immBatch = 0;
     cfg_errorCheck = 0;
     cfg_traceFifo = 0;
     cfg_traceFunc = 0;
+    cfg_profFunc = 0;
     FILE *fp = fopen(MESAGLCFG, "r");
     if (fp != NULL) {
         char line[32];
@@ -1633,10 +1994,12 @@ static void conf_MGLOptions(void)
             cfg_xLength = (i == 1)? v:cfg_xLength;
             i = sscanf(line, "VertexCacheMB,%d", &v);
             cfg_vertCacheMB = (i == 1)? v:cfg_vertCacheMB;
+            i = sscanf(line, "VertexCacheHash,%d", &v);
+            cfg_vertCacheHash = ((i == 1) && v)? 1:cfg_vertCacheHash;
             i = sscanf(line, "DispTimerMS,%d", &v);
             cfg_dispTimerMS = (i == 1)? v:cfg_dispTimerMS;
             i = sscanf(line, "BufOAccelEN,%d", &v);
-            cfg_bufoAccelEN = ((i == 1) && v)? 1:cfg_bufoAccelEN;
+            cfg_bufoAccelEN = ((i == 1) && v)? ((v > 1)? 2:1):cfg_bufoAccelEN;
             i = sscanf(line, "ContextMSAA,%d", &v);
             cfg_cntxMSAA = (i == 1)? ((v & 0x03U) << 2):cfg_cntxMSAA;
             i = sscanf(line, "ContextSRGB,%d", &v);
@@ -1645,16 +2008,34 @@ static void conf_MGLOptions(void)
             cfg_cntxVsyncOff = ((i == 1) && v)? 1:cfg_cntxVsyncOff;
             i = sscanf(line, "RenderScalerOff,%d", &v);
             cfg_renderScalerOff = ((i == 1) && v)? 1:cfg_renderScalerOff;
+            i = sscanf(line, "ScalerFilter,%d", &v);
+            cfg_scalerFilter = (i == 1)? (v & 0x03U):cfg_scalerFilter;
             i = sscanf(line, "FpsLimit,%d", &v);
             cfg_fpsLimit = (i == 1)? (v & 0x7FU):cfg_fpsLimit;
+            i = sscanf(line, "FramePacing,%d", &v);
+            cfg_framePacing = (i == 1)? (v % 3):cfg_framePacing;
+            i = sscanf(line, "RenderThread,%d", &v);
+            cfg_renderThread = ((i == 1) && v)? 1:cfg_renderThread;
+            i = sscanf(line, "ReadPixelsPBO,%d", &v);
+            cfg_readPixelsPBO = (i == 1)? MIN((v & 0x07U), MAX_RPBO_RING):cfg_readPixelsPBO;
+            i = sscanf(line, "TexZeroCopy,%d", &v);
+            cfg_texZeroCopy = ((i == 1) && v)? 1:cfg_texZeroCopy;
             i = sscanf(line, "DumpShader,%d", &v);
             cfg_shaderDump = ((i == 1) && v)? 1:cfg_shaderDump;
+            i = sscanf(line, "ShaderCache,%d", &v);
+            cfg_shaderCache = ((i == 1) && v)? 1:cfg_shaderCache;
+            i = sscanf(line, "StateShadow,%d", &v);
+            cfg_stateShadow = ((i == 1) && v)? 1:cfg_stateShadow;
+            i = sscanf(line, "ImmBatch,%d", &v);
+            cfg_immBatch = ((i == 1) && v)? 1:cfg_immBatch;
             i = sscanf(line, "CheckError,%d", &v);
             cfg_errorCheck = ((i == 1) && v)? 1:cfg_errorCheck;
             i = sscanf(line, "FifoTrace,%d", &v);
             cfg_traceFifo = ((i == 1) && v)? 1:cfg_traceFifo;
             i = sscanf(line, "FuncTrace,%d", &v);
             cfg_traceFunc = (i == 1)? (v % 3):cfg_traceFunc;
+            i = sscanf(line, "FuncProfile,%d", &v);
+            cfg_profFunc = ((i == 1) && v)? 1:cfg_profFunc;
         }
         fclose(fp);
     }
@@ -1685,6 +2066,7 @@ void GLExtUncapped(int xwine) { cfg_xWine = xwine; if (cfg_xWine) { cfg_xYear =
 int GetGLExtYear(void) { return cfg_xYear; }
 int GetGLExtLength(void) { return cfg_xLength; }
 int GetVertCacheMB(void) { return cfg_vertCacheMB; }
+int GetVertCacheHash(void) { return cfg_vertCacheHash; }
 int GetDispTimerMS(void) { return cfg_dispTimerMS; }
 int GetBufOAccelEN(void) { return cfg_bufoAccelEN; }
 int GetContextMSAA(void) { return (cfg_cntxMSAA > 8)? 16:cfg_cntxMSAA; }
@@ -1692,11 +2074,20 @@ int ContextVsyncOff(void) { return cfg_cntxVsyncOff; }
 int RenderScalerOff(void) { return cfg_renderScalerOff; }
 int ScalerBlitFlip(void) { return cfg_blitFlip; }
 int ScalerSRGBCorr(void) { return cfg_xWine; }
+int ScalerFilter(void) { return cfg_scalerFilter; }
 int GetFpsLimit(void) { return cfg_fpsLimit; }
+int GLFramePacing(void) { return cfg_framePacing; }
+int GLRenderThread(void) { return cfg_renderThread; }
+int GLReadPixelsPBO(void) { return cfg_readPixelsPBO; }
+int GLTexZeroCopy(void) { return cfg_texZeroCopy; }
 int GLShaderDump(void) { return cfg_shaderDump; }
+int GLShaderCache(void) { return cfg_shaderCache; }
+int GLStateShadow(void) { return cfg_stateShadow; }
+int GLImmBatch(void) { return cfg_immBatch; }
 int GLCheckError(void) { return cfg_errorCheck; }
 int GLFifoTrace(void) { return cfg_traceFifo; }
 int GLFuncTrace(void) { return (cfg_traceFifo)? 0:cfg_traceFunc; }
+int GLFuncProfile(void) { return cfg_profFunc; }
 
 #ifdef CONFIG_WIN32
 static HINSTANCE hDll = 0;
@@ -1707,6 +2098,7 @@ static void *hDll = 0;
 
 void FiniMesaGL(void)
 {
+    MGLShaderCacheFini();
     if (hDll) {
 #ifdef CONFIG_WIN32
         FreeLibrary(hDll);
@@ -1720,11 +2112,22 @@ void FiniMesaGL(void)
         tblMesaGL[i].ptr = 0;
 }
 
+void ImplMesaGLFree(void)
+{
+    wrReadPixelsRingFree();
+    wrTexUnpackPinnedFree();
+}
+
 void ImplMesaGLReset(void)
 {
     for (int i = 0 ; i < FEnum_zzMGLFuncEnum_max; i++)
         tblMesaGL[i].impl = 0;
     conf_MGLOptions();
+    wrReadPixelsRingReset();
+    wrTexUnpackPinnedReset();
+    MGLShaderCacheReset();
+    MGLStateInit();
+    MGLImmInit();
 }
 
 int InitMesaGL(void)
@@ -1753,6 +2156,7 @@ int InitMesaGL(void)
 
     for (int i = 0; i < FEnum_zzMGLFuncEnum_max; i++) {
         char func[64];
+        tblMesaGL[i].nargs = getNumArgs(tblMesaGL[i].sym);
         strncpy(func, tblMesaGL[i].sym + 1, sizeof(func)-1);
         for (int j = 0; j < sizeof(func); j++) {
             if (func[j] == '@') {
@@ -27,9 +27,14 @@
 #include "mglvarry.h"
 #include "mglmapbo.h"
 #include "mglcntx.h"
+#include "mglprof.h"
+#include "mglshcache.h"
+#include "mglstate.h"
+#include "mglimm.h"
 
 int GLFEnumArgsCnt(const int);
 void *GLFEnumFuncPtr(const int);
+const char *GLFEnumFuncSym(const int);
 int ExtFuncIsValid(const char *);
 int GLIsD3D12(void);
 int wrMapOrderPoints(uint32_t);
@@ -38,6 +43,11 @@ int wrSizeMapBuffer(const int);
 void wrCompileShaderStatus(const int);
 void wrFillBufObj(uint32_t, void *, mapbufo_t *);
 void wrFlushBufObj(uint32_t, mapbufo_t *);
+int wrReadPixelsRing(uint32_t *, void *);
+int wrTexUnpackPinned(const void *, const uint32_t);
+void wrTexUnpackPinnedDone(void);
+void wrTexUnpackPinnedCurrent(uint32_t);
+void wrTexUnpackPinnedDrop(uint32_t);
 void wrContextSRGB(int);
 void fgFontGenList(int, int, uint32_t);
 const char *getGLFuncStr(int);
@@ -51,6 +61,7 @@ void GLExtUncapped(int);
 int GetGLExtYear(void);
 int GetGLExtLength(void);
 int GetVertCacheMB(void);
+int GetVertCacheHash(void);
 int GetDispTimerMS(void);
 int GetBufOAccelEN(void);
 int GetContextMSAA(void);
@@ -59,14 +70,24 @@ int ContextVsyncOff(void);
 int RenderScalerOff(void);
 int ScalerBlitFlip(void);
 int ScalerSRGBCorr(void);
+int ScalerFilter(void);
 int SwapFpsLimit(int);
 int GetFpsLimit(void);
+int GLFramePacing(void);
+int GLRenderThread(void);
+int GLReadPixelsPBO(void);
+int GLTexZeroCopy(void);
 int GLShaderDump(void);
+int GLShaderCache(void);
+int GLStateShadow(void);
+int GLImmBatch(void);
 int GLCheckError(void);
 int GLFifoTrace(void);
 int GLFuncTrace(void);
+int GLFuncProfile(void);
 void FiniMesaGL(void);
 void ImplMesaGLReset(void);
+void ImplMesaGLFree(void);
 int InitMesaGL(void);
 void InitMesaGLExt(void);
 
@@ -23,7 +23,12 @@
 #include "hw/hw.h"
 #include "hw/i386/pc.h"
 #include "hw/sysbus.h"
+#include "hw/qdev-properties.h"
+#include "hw/ptpace.h"
+#include "hw/pttrace.h"
 #include "exec/address-spaces.h"
+#include "qemu/thread.h"
+#include "qemu/xxhash.h"
 
 #include "mesagl_impl.h"
 
@@ -43,6 +48,24 @@
 #endif
 
 
+typedef struct _rndrjob {
+    hwaddr addr;
+    uint64_t val;
+    uint32_t *fifo, *data;
+    struct _rndrjob *next;
+} RNDRJOB, *PRNDRJOB;
+#define MAX_VTXPUSH_LOG 32
+
+typedef struct {
+    vtxarry_t *arry;
+    const char *name;
+    int idx;
+    int szElem;
+    int cbElem;
+} vtxdesc_t;
+
+#define MAX_RNDR_PEND 8
+
 typedef struct MesaPTState
 {
     SysBusDevice parent_obj;
@@ -71,33 +94,171 @@ typedef struct MesaPTState
               Interleaved, SecondaryColor, FogCoord, Weight, GenAttrib[2];
     uint32_t elemMax;
     int szVertCache;
+    int vtxHash;
+    struct {
+        uintptr_t lo, hi;
+    } vtxPushLog[MAX_VTXPUSH_LOG];
+    uint32_t vtxPushGen, vtxPushCopy, vtxPushSkip;
+    vtxdesc_t vtxDesc[MAX_TEXUNIT + 10];
+    int vtxDescCnt, vtxDescDirty;
     int texUnit;
-    int pixPackBuf, pixUnpackBuf;
+    int pixPackBuf, pixUnpackBuf, texPinned;
     int szPackWidth, szUnpackWidth;
     int szPackHeight, szUnpackHeight;
     int queryBuf;
     int arrayBuf;
     int elemArryBuf;
     int vao;
+    int clientAttribDepth;
     mapbufo_t *BufObj;
     int BufIdx;
     uint32_t szUsedBuf;
     QEMUTimer *dispTimer;
     int64_t crashRC;
     PERFSTAT perfs;
+    QemuThread rndrThread;
+    QemuMutex rndrMutex;
+    QemuCond rndrCond, rndrIdle;
+    PRNDRJOB rndrHead, rndrTail;
+    int rndrActive, rndrBusy, rndrPend, rndrQuit;
+    uint32_t rndrAsync, rndrSync;
+    char *traceRecord, *traceReplay;
+    PTTrace *trace;
+    PTPace *pace;
+    bool headless;
 
 } MesaPTState;
 
-static void vtxarry_init(vtxarry_t *varry, int size, int type, int stride, void *ptr)
+static int vtxarry_bind(MesaPTState *s)
 {
+#define VTXBIND_TEXCOORD    0x09
+#define VTXBIND_ATTRIB      (VTXBIND_TEXCOORD + MAX_TEXUNIT)
+    switch (s->FEnum) {
+        case FEnum_glVertexPointer:
+        case FEnum_glVertexPointerEXT:
+            return 0;
+        case FEnum_glNormalPointer:
+        case FEnum_glNormalPointerEXT:
+            return 1;
+        case FEnum_glColorPointer:
+        case FEnum_glColorPointerEXT:
+            return 2;
+        case FEnum_glIndexPointer:
+        case FEnum_glIndexPointerEXT:
+            return 3;
+        case FEnum_glEdgeFlagPointer:
+        case FEnum_glEdgeFlagPointerEXT:
+            return 4;
+        case FEnum_glSecondaryColorPointer:
+        case FEnum_glSecondaryColorPointerEXT:
+            return 5;
+        case FEnum_glFogCoordPointer:
+        case FEnum_glFogCoordPointerEXT:
+            return 6;
+        case FEnum_glVertexWeightPointerEXT:
+        case FEnum_glWeightPointerARB:
+            return 7;
+        case FEnum_glInterleavedArrays:
+            return 8;
+        case FEnum_glTexCoordPointer:
+        case FEnum_glTexCoordPointerEXT:
+            return VTXBIND_TEXCOORD + s->texUnit;
+        case FEnum_glVertexAttribIPointer:
+        case FEnum_glVertexAttribIPointerEXT:
+        case FEnum_glVertexAttribLPointer:
+        case FEnum_glVertexAttribLPointerEXT:
+        case FEnum_glVertexAttribPointer:
+        case FEnum_glVertexAttribPointerARB:
+            return ((VTXBIND_ATTRIB + s->arg[0]) < VARRY_BIND_MAX)? (VTXBIND_ATTRIB + s->arg[0]):-1;
+        default:
+            return -1;
+    }
+}
+
+static void vtxarry_init(MesaPTState *s, vtxarry_t *varry, int size, int type, int stride, void *ptr)
+{
+    BindVertex(vtxarry_bind(s), ((s->arrayBuf == 0) || (s->FEnum == FEnum_glInterleavedArrays))? ptr:0);
+    s->vtxDescDirty = 1;
     varry->size = size;
     varry->type = type;
     varry->stride = stride;
     varry->ptr = ptr;
+    varry->hdst = 0;
+    varry->hlen = 0;
+}
+
+static uint64_t vtxarry_hash(const void *src, int len)
+{
+    const uint8_t *p = src;
+    uint64_t v[4], h64, d;
+    int i = 0;
+
+    if (len >= 32) {
+        v[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+        v[1] = XXH_PRIME64_2;
+        v[2] = 0;
+        v[3] = -XXH_PRIME64_1;
+        for (; (i + 32) <= len; i += 32) {
+            for (int j = 0; j < 4; j++) {
+                memcpy(&d, p + i + (j << 3), sizeof(uint64_t));
+                v[j] = XXH64_round(v[j], d);
+            }
+        }
+        h64 = XXH64_mergerounds(v[0], v[1], v[2], v[3]);
+    }
+    else
+        h64 = XXH_PRIME64_5;
+    h64 += len;
+    for (; (i + 8) <= len; i += 8) {
+        memcpy(&d, p + i, sizeof(uint64_t));
+        h64 ^= XXH64_round(0, d);
+        h64 = rol64(h64, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    for (; i < len; i++) {
+        h64 ^= p[i] * XXH_PRIME64_5;
+        h64 = rol64(h64, 11) * XXH_PRIME64_1;
+    }
+    return XXH64_avalanche(h64);
+}
+
+static int vtxarry_clobbered(MesaPTState *s, uint32_t gen, uintptr_t lo, uintptr_t hi)
+{
+    if ((s->vtxPushGen - gen) > MAX_VTXPUSH_LOG)
+        return 1;
+    for (uint32_t g = gen + 1; g != s->vtxPushGen; g++) {
+        int i = g % MAX_VTXPUSH_LOG;
+        if ((s->vtxPushLog[i].lo < hi) && (s->vtxPushLog[i].hi > lo))
+            return 1;
+    }
+    return 0;
+}
+
+static void vtxarry_copy(MesaPTState *s, vtxarry_t *arry, uint8_t *dst, const void *src, int len)
+{
+    int i;
+
+    if (s->vtxHash) {
+        uint64_t h = vtxarry_hash(src, len);
+        if ((arry->hdst == (uintptr_t)dst) && (arry->hlen == len) && (arry->hash == h) &&
+            !vtxarry_clobbered(s, arry->hgen, arry->hdst, arry->hdst + len)) {
+            s->vtxPushSkip++;
+            return;
+        }
+        arry->hash = h;
+    }
+    memcpy(dst, src, len);
+    i = s->vtxPushGen % MAX_VTXPUSH_LOG;
+    s->vtxPushLog[i].lo = (uintptr_t)dst;
+    s->vtxPushLog[i].hi = (uintptr_t)dst + len;
+    arry->hdst = (uintptr_t)dst;
+    arry->hlen = len;
+    arry->hgen = s->vtxPushGen++;
+    s->vtxPushCopy++;
 }
 
 static void vtxarry_ptr_reset(MesaPTState *s)
 {
+    s->vtxDescDirty = 1;
     s->Color.ptr = 0;
     s->EdgeFlag.ptr = 0;
     s->Index.ptr = 0;
@@ -116,6 +277,7 @@ static void vtxarry_state(MesaPTState *s, uint32_t arry, int st)
 {
 #define GENERIC_ATTRIB6 0x06
 #define GENERIC_ATTRIB7 0x07
+    s->vtxDescDirty = 1;
     switch (arry) {
         case GL_COLOR_ARRAY:
             s->Color.enable = st;
@@ -197,139 +359,115 @@ static vtxarry_t *vattr2arry(MesaPTState *s, int attr)
     return arry;
 }
 
+static void vtxdesc_add(MesaPTState *s, vtxarry_t *arry, const char *name, int idx)
+{
+    if (arry->enable && arry->ptr) {
+        vtxdesc_t *d = &s->vtxDesc[s->vtxDescCnt++];
+        d->arry = arry;
+        d->name = name;
+        d->idx = idx;
+        d->szElem = szgldata(arry->size, arry->type);
+        d->cbElem = (arry->stride)? arry->stride:d->szElem;
+    }
+}
+
+static void vtxdesc_build(MesaPTState *s)
+{
+    int i;
+
+    /* Order must match the guest packing order of client arrays */
+    s->vtxDescCnt = 0;
+    vtxdesc_add(s, &s->Color, "Color", -1);
+    vtxdesc_add(s, &s->EdgeFlag, "EdgeFlag", -1);
+    vtxdesc_add(s, &s->Index, "Index", -1);
+    vtxdesc_add(s, &s->Normal, "Normal", -1);
+    for (i = 0; i < MAX_TEXUNIT; i++)
+        vtxdesc_add(s, &s->TexCoord[i], "TexCoord", i);
+    vtxdesc_add(s, &s->Vertex, "Vertex", -1);
+    vtxdesc_add(s, &s->SecondaryColor, "SecondaryColor", -1);
+    vtxdesc_add(s, &s->FogCoord, "FogCoord", -1);
+    vtxdesc_add(s, &s->Weight, "Weight", -1);
+    for (i = 0; i < 2; i++)
+        vtxdesc_add(s, &s->GenAttrib[i], "GenAttrib", i);
+    s->vtxDescDirty = 0;
+}
+
+static int vtxdesc_push(MesaPTState *s, const vtxdesc_t *d, const uint8_t *varry_ptr, int start, int end)
+{
+    int n = (d->cbElem*(end - start) + d->szElem + 3) >> 2,
+        cbMax = s->szVertCache >> 1;
+
+    vtxarry_copy(s, d->arry, (uint8_t *)d->arry->ptr + (d->cbElem*start), varry_ptr, MIN((n << 2), cbMax));
+    if ((n << 2) > cbMax) {
+        if (d->idx < 0)
+            DPRINTF(" *WARN* %s Array overflowed, cbElem %04x maxElem %04x", d->name, d->cbElem, s->elemMax);
+        else
+            DPRINTF(" *WARN* %s%d Array overflowed, cbElem %04x maxElem %04x", d->name, d->idx, d->cbElem, s->elemMax);
+    }
+    return (n + (n & 0x01)) << 2;
+}
+
 static void PushVertexArray(MesaPTState *s, const void *pshm, int start, int end)
 {
-    uint8_t *varry_ptr = (uint8_t *)pshm;
-    int i, cbElem, n, ovfl;
+    const uint8_t *varry_ptr = pshm;
+    int i, cb;
+
     if (s->Interleaved.enable && s->Interleaved.ptr) {
-        cbElem = (s->Interleaved.stride)? s->Interleaved.stride:s->Interleaved.size;
-        n = (cbElem*(end - start) + s->Interleaved.size);
-        n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-        ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-        memcpy(s->Interleaved.ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-        varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-        s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-        if (ovfl)
-            DPRINTF(" *WARN* Interleaved Array overflowed, cbElem %04x maxElem %04x", cbElem, s->elemMax);
+        vtxdesc_t d = {
+            .arry = &s->Interleaved,
+            .name = "Interleaved",
+            .idx = -1,
+            .szElem = s->Interleaved.size,
+            .cbElem = (s->Interleaved.stride)? s->Interleaved.stride:s->Interleaved.size,
+        };
+        s->datacb += vtxdesc_push(s, &d, varry_ptr, start, end);
         s->Interleaved.enable = 0;
     }
     else {
-        if (s->Color.enable && s->Color.ptr) {
-            cbElem = (s->Color.stride)? s->Color.stride:szgldata(s->Color.size,s->Color.type);
-            n = cbElem*(end - start) + szgldata(s->Color.size,s->Color.type);
-            n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-            ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-            memcpy(s->Color.ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-            varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            if (ovfl)
-                DPRINTF(" *WARN* Color Array overflowed, cbElem %04x maxElem %04x", cbElem, s->elemMax);
-        }
-        if (s->EdgeFlag.enable && s->EdgeFlag.ptr) {
-            cbElem = (s->EdgeFlag.stride)? s->EdgeFlag.stride:szgldata(s->EdgeFlag.size,s->EdgeFlag.type);
-            n = cbElem*(end - start) + szgldata(s->EdgeFlag.size,s->EdgeFlag.type);
-            n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-            ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-            memcpy(s->EdgeFlag.ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-            varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            if (ovfl)
-                DPRINTF(" *WARN* EdgeFlag Array overflowed, cbElem %04x maxElem %04x", cbElem, s->elemMax);
-        }
-        if (s->Index.enable && s->Index.ptr) {
-            cbElem = (s->Index.stride)? s->Index.stride:szgldata(s->Index.size,s->Index.type);
-            n = cbElem*(end - start) + szgldata(s->Index.size,s->Index.type);
-            n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-            ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-            memcpy(s->Index.ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-            varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            if (ovfl)
-                DPRINTF(" *WARN* Index Array overflowed, cbElem %04x maxElem %04x", cbElem, s->elemMax);
-        }
-        if (s->Normal.enable && s->Normal.ptr) {
-            cbElem = (s->Normal.stride)? s->Normal.stride:szgldata(s->Normal.size,s->Normal.type);
-            n = cbElem*(end - start) + szgldata(s->Normal.size,s->Normal.type);
-            n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-            ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-            memcpy(s->Normal.ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-            varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            if (ovfl)
-                DPRINTF(" *WARN* Normal Array overflowed, cbElem %04x maxElem %04x", cbElem, s->elemMax);
-        }
-        for (i = 0; i < MAX_TEXUNIT; i++) {
-            if (s->TexCoord[i].enable && s->TexCoord[i].ptr) {
-                cbElem = (s->TexCoord[i].stride)? s->TexCoord[i].stride:szgldata(s->TexCoord[i].size,s->TexCoord[i].type);
-                n = cbElem*(end - start) + szgldata(s->TexCoord[i].size,s->TexCoord[i].type);
-                n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-                ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-                memcpy(s->TexCoord[i].ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-                varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-                s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-                if (ovfl)
-                    DPRINTF(" *WARN* TexCoord%d Array overflowed, cbElem %04x maxElem %04x", i, cbElem, s->elemMax);
-            }
-        }
-        if (s->Vertex.enable && s->Vertex.ptr) {
-            cbElem = (s->Vertex.stride)? s->Vertex.stride:szgldata(s->Vertex.size,s->Vertex.type);
-            n = cbElem*(end - start) + szgldata(s->Vertex.size,s->Vertex.type);
-            n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-            ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-            memcpy(s->Vertex.ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-            varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            if (ovfl)
-                DPRINTF(" *WARN* Vertex Array overflowed, cbElem %04x maxElem %04x", cbElem, s->elemMax);
-        }
-        if (s->SecondaryColor.enable && s->SecondaryColor.ptr) {
-            cbElem = (s->SecondaryColor.stride)? s->SecondaryColor.stride:szgldata(s->SecondaryColor.size,s->SecondaryColor.type);
-            n = cbElem*(end - start) + szgldata(s->SecondaryColor.size,s->SecondaryColor.type);
-            n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-            ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-            memcpy(s->SecondaryColor.ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-            varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            if (ovfl)
-                DPRINTF(" *WARN* SecondaryColor Array overflowed, cbElem %04x maxElem %04x", cbElem, s->elemMax);
-        }
-        if (s->FogCoord.enable && s->FogCoord.ptr) {
-            cbElem = (s->FogCoord.stride)? s->FogCoord.stride:szgldata(s->FogCoord.size,s->FogCoord.type);
-            n = cbElem*(end - start) + szgldata(s->FogCoord.size,s->FogCoord.type);
-            n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-            ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-            memcpy(s->FogCoord.ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-            varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            if (ovfl)
-                DPRINTF(" *WARN* FogCoord Array overflowed, cbElem %04x maxElem %04x", cbElem, s->elemMax);
-        }
-        if (s->Weight.enable && s->Weight.ptr) {
-            cbElem = (s->Weight.stride)? s->Weight.stride:szgldata(s->Weight.size,s->Weight.type);
-            n = cbElem*(end - start) + szgldata(s->Weight.size,s->Weight.type);
-            n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-            ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-            memcpy(s->Weight.ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-            varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-            if (ovfl)
-                DPRINTF(" *WARN* Weight Array overflowed, cbElem %04x maxElem %04x", cbElem, s->elemMax);
-        }
-        for (i = 0; i < 2; i++) {
-            if (s->GenAttrib[i].enable && s->GenAttrib[i].ptr) {
-                cbElem = (s->GenAttrib[i].stride)? s->GenAttrib[i].stride:szgldata(s->GenAttrib[i].size,s->GenAttrib[i].type);
-                n = cbElem*(end - start) + szgldata(s->GenAttrib[i].size,s->GenAttrib[i].type);
-                n = (n & 0x03)? ((n >> 2) + 1):(n >> 2);
-                ovfl = ((n << 2) > (s->szVertCache >> 1))? 1:0;
-                memcpy(s->GenAttrib[i].ptr + (cbElem*start), varry_ptr, ((ovfl)? (s->szVertCache >> 1):(n << 2)));
-                varry_ptr += (n & 0x01)? ((n + 1) << 2):(n << 2);
-                s->datacb += (n & 0x01)? ((n + 1) << 2):(n << 2);
-                if (ovfl)
-                    DPRINTF(" *WARN* GenAttrib%d Array overflowed, cbElem %04x maxElem %04x", i, cbElem, s->elemMax);
-            }
+        if (s->vtxDescDirty)
+            vtxdesc_build(s);
+        for (i = 0; i < s->vtxDescCnt; i++) {
+            cb = vtxdesc_push(s, &s->vtxDesc[i], varry_ptr, start, end);
+            varry_ptr += cb;
+            s->datacb += cb;
         }
     }
 }
+/*
+ * Index range of client-side glDrawElements in a single pass. Each index
+ * width gets its own branch-free loop so that the compiler can keep the
+ * running min/max in vector registers.
+ */
+#define ELEM_RANGE(T) \
+    do { \
+        const T *p = idx; \
+        T lo = (T)-1, hi = 0; \
+        for (int i = 0; i < count; i++) { \
+            lo = MIN(lo, p[i]); \
+            hi = MAX(hi, p[i]); \
+        } \
+        *start = lo; *end = hi; \
+    } while (0)
+
+static void elemRange(const void *idx, int count, int szElem, int *start, int *end)
+{
+    *start = 0;
+    *end = 0;
+    if (count <= 0)
+        return;
+    switch (szElem) {
+        case 1:
+            ELEM_RANGE(uint8_t);
+            break;
+        case 2:
+            ELEM_RANGE(uint16_t);
+            break;
+        case 4:
+            ELEM_RANGE(uint32_t);
+            break;
+    }
+}
+
 static void InitClientStates(MesaPTState *s)
 {
     memset(&s->Color, 0, sizeof(vtxarry_t));
@@ -343,10 +481,12 @@ static void InitClientStates(MesaPTState *s)
     memset(&s->Weight, 0, sizeof(vtxarry_t));
     memset(s->TexCoord, 0, sizeof(vtxarry_t[MAX_TEXUNIT]));
     memset(s->GenAttrib, 0, sizeof(vtxarry_t[2]));
+    s->vtxDescDirty = 1;
     s->elemMax = 0;
     s->texUnit = 0;
     s->arrayBuf = 0;
     s->vao = 0;
+    s->clientAttribDepth = 0;
     s->elemArryBuf = 0;
     s->queryBuf = 0;
     s->pixPackBuf = 0; s->pixUnpackBuf = 0;
@@ -371,11 +511,22 @@ static void dispTimerSched(QEMUTimer *ts, int64_t *crashRC)
         *crashRC = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
 }
 
+static void rndrWaitIdle(MesaPTState *s)
+{
+    qemu_mutex_lock(&s->rndrMutex);
+    while (s->rndrHead || s->rndrBusy)
+        qemu_cond_wait(&s->rndrIdle, &s->rndrMutex);
+    qemu_mutex_unlock(&s->rndrMutex);
+}
+
 static uint64_t mesapt_read(void *opaque, hwaddr addr, unsigned size)
 {
     MesaPTState *s = opaque;
     uint32_t val = 0;
 
+    if (s->rndrActive)
+        rndrWaitIdle(s);
+
     switch (addr) {
         case 0xFB8:
             val = glwnd_ready();
@@ -400,6 +551,8 @@ static uint64_t mesapt_read(void *opaque, hwaddr addr, unsigned size)
         default:
             break;
     }
+    if (s->trace && s->traceRecord && (addr == 0xFB8))
+        pttrace_read(s->trace, addr, val);
 
     return val;
 }
@@ -510,6 +663,14 @@ static int PArgsShouldAligned(MesaPTState *s)
         x = MGLFBT_SIZE; }
 #define PTR(x,y) (((uint8_t *)x)+y)
 #define VAL(x) (uintptr_t)x
+static uintptr_t texUnpackPtr(MesaPTState *s, uint32_t *texPtr, uint32_t szTex)
+{
+    if (!wrTexUnpackPinned(texPtr, (s->fbtm_ptr + MGLFBT_SIZE) - (uint8_t *)texPtr))
+        return VAL(texPtr);
+    s->texPinned = 1;
+    return 0;
+}
+
 static void processArgs(MesaPTState *s)
 {
     uint8_t *outshm = s->fifo_ptr + (MGLSHM_SIZE - (3*PAGE_SIZE));
@@ -567,7 +728,7 @@ static void processArgs(MesaPTState *s)
             break;
         case FEnum_glColorPointer:
         case FEnum_glColorPointerEXT:
-            vtxarry_init(&s->Color, s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
+            vtxarry_init(s, &s->Color, s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
                 LookupVertex((s->FEnum == FEnum_glColorPointer)? s->arg[3]:s->arg[4], s->szVertCache):
                 (void *)(uintptr_t)((s->FEnum == FEnum_glColorPointer)? s->arg[3]:s->arg[4]));
             s->parg[3] = VAL(s->Color.ptr);
@@ -575,7 +736,7 @@ static void processArgs(MesaPTState *s)
             break;
         case FEnum_glEdgeFlagPointer:
         case FEnum_glEdgeFlagPointerEXT:
-            vtxarry_init(&s->EdgeFlag, 1, GL_BYTE, s->arg[0], (s->arrayBuf == 0)?
+            vtxarry_init(s, &s->EdgeFlag, 1, GL_BYTE, s->arg[0], (s->arrayBuf == 0)?
                 LookupVertex((s->FEnum == FEnum_glEdgeFlagPointer)? s->arg[1]:s->arg[2], s->szVertCache):
                 (void *)(uintptr_t)((s->FEnum == FEnum_glEdgeFlagPointer)? s->arg[1]:s->arg[2]));
             s->parg[1] = VAL(s->EdgeFlag.ptr);
@@ -583,7 +744,7 @@ static void processArgs(MesaPTState *s)
             break;
         case FEnum_glIndexPointer:
         case FEnum_glIndexPointerEXT:
-            vtxarry_init(&s->Index, 1, s->arg[0], s->arg[1], (s->arrayBuf == 0)?
+            vtxarry_init(s, &s->Index, 1, s->arg[0], s->arg[1], (s->arrayBuf == 0)?
                 LookupVertex((s->FEnum == FEnum_glIndexPointer)? s->arg[2]:s->arg[3], s->szVertCache):
                 (void *)(uintptr_t)((s->FEnum == FEnum_glIndexPointer)? s->arg[2]:s->arg[3]));
             s->parg[2] = VAL(s->Index.ptr);
@@ -591,7 +752,7 @@ static void processArgs(MesaPTState *s)
             break;
         case FEnum_glNormalPointer:
         case FEnum_glNormalPointerEXT:
-            vtxarry_init(&s->Normal, 3, s->arg[0], s->arg[1], (s->arrayBuf == 0)?
+            vtxarry_init(s, &s->Normal, 3, s->arg[0], s->arg[1], (s->arrayBuf == 0)?
                 LookupVertex((s->FEnum == FEnum_glNormalPointer)? s->arg[2]:s->arg[3], s->szVertCache):
                 (void *)(uintptr_t)((s->FEnum == FEnum_glNormalPointer)? s->arg[2]:s->arg[3]));
             s->parg[2] = VAL(s->Normal.ptr);
@@ -599,7 +760,7 @@ static void processArgs(MesaPTState *s)
             break;
         case FEnum_glTexCoordPointer:
         case FEnum_glTexCoordPointerEXT:
-            vtxarry_init(&s->TexCoord[s->texUnit], s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
+            vtxarry_init(s, &s->TexCoord[s->texUnit], s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
                 LookupVertex((s->FEnum == FEnum_glTexCoordPointer)? s->arg[3]:s->arg[4], s->szVertCache):
                 (void *)(uintptr_t)((s->FEnum == FEnum_glTexCoordPointer)? s->arg[3]:s->arg[4]));
             s->parg[3] = VAL(s->TexCoord[s->texUnit].ptr);
@@ -607,7 +768,7 @@ static void processArgs(MesaPTState *s)
             break;
         case FEnum_glVertexPointer:
         case FEnum_glVertexPointerEXT:
-            vtxarry_init(&s->Vertex, s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
+            vtxarry_init(s, &s->Vertex, s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
                 LookupVertex((s->FEnum == FEnum_glVertexPointer)? s->arg[3]:s->arg[4], s->szVertCache):
                 (void *)(uintptr_t)((s->FEnum == FEnum_glVertexPointer)? s->arg[3]:s->arg[4]));
             s->parg[3] = VAL(s->Vertex.ptr);
@@ -615,19 +776,19 @@ static void processArgs(MesaPTState *s)
             break;
         case FEnum_glSecondaryColorPointer:
         case FEnum_glSecondaryColorPointerEXT:
-            vtxarry_init(&s->SecondaryColor, s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
+            vtxarry_init(s, &s->SecondaryColor, s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
                 LookupVertex(s->arg[3], s->szVertCache):(void *)(uintptr_t)s->arg[3]);
             s->parg[3] = VAL(s->SecondaryColor.ptr);
             break;
         case FEnum_glFogCoordPointer:
         case FEnum_glFogCoordPointerEXT:
-            vtxarry_init(&s->FogCoord, 1, s->arg[0], s->arg[1], (s->arrayBuf == 0)?
+            vtxarry_init(s, &s->FogCoord, 1, s->arg[0], s->arg[1], (s->arrayBuf == 0)?
                 LookupVertex(s->arg[2], s->szVertCache):(void *)(uintptr_t)s->arg[2]);
             s->parg[2] = VAL(s->FogCoord.ptr);
             break;
         case FEnum_glVertexWeightPointerEXT:
         case FEnum_glWeightPointerARB:
-            vtxarry_init(&s->Weight, s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
+            vtxarry_init(s, &s->Weight, s->arg[0], s->arg[1], s->arg[2], (s->arrayBuf == 0)?
                 LookupVertex(s->arg[3], s->szVertCache):(void *)(uintptr_t)s->arg[3]);
             s->parg[3] = VAL(s->Weight.ptr);
             break;
@@ -638,7 +799,7 @@ static void processArgs(MesaPTState *s)
         case FEnum_glVertexAttribPointerNV:
             {
                 vtxarry_t *arry = vattr2arry(s, s->arg[0]);
-                vtxarry_init(arry, s->arg[1], s->arg[2], s->arg[3], (s->arrayBuf == 0)?
+                vtxarry_init(s, arry, s->arg[1], s->arg[2], s->arg[3], (s->arrayBuf == 0)?
                         LookupVertex(s->arg[4], s->szVertCache):(void *)(uintptr_t)s->arg[4]);
                 s->parg[0] = VAL(arry->ptr);
             }
@@ -647,13 +808,13 @@ static void processArgs(MesaPTState *s)
         case FEnum_glVertexAttribPointerARB:
             {
                 vtxarry_t *arry = vattr2arry(s, s->arg[0]);
-                vtxarry_init(arry, s->arg[1], s->arg[2], s->arg[4], (s->arrayBuf == 0)?
+                vtxarry_init(s, arry, s->arg[1], s->arg[2], s->arg[4], (s->arrayBuf == 0)?
                         LookupVertex(s->arg[5], s->szVertCache):(void *)(uintptr_t)s->arg[5]);
                 s->parg[1] = VAL(arry->ptr);
             }
             break;
         case FEnum_glInterleavedArrays:
-            vtxarry_init(&s->Interleaved, szgldata(s->arg[0], 0), 0, s->arg[1], LookupVertex(s->arg[2], s->szVertCache));
+            vtxarry_init(s, &s->Interleaved, szgldata(s->arg[0], 0), 0, s->arg[1], LookupVertex(s->arg[2], s->szVertCache));
             s->Interleaved.enable = 1;
             s->parg[2] = VAL(s->Interleaved.ptr);
             break;
@@ -919,36 +1080,8 @@ static void processArgs(MesaPTState *s)
             if (s->elemArryBuf == 0) {
                 s->datacb = ALIGNED(s->arg[1] * szgldata(0, s->arg[2]));
                 s->parg[3] = VAL(s->hshm);
-                int start, end = 0;
-                for (int i = 0; i < s->arg[1]; i++) {
-                    if (szgldata(0, s->arg[2]) == 1) {
-                        uint8_t *p = (uint8_t *)s->hshm;
-                        end = (p[i] > end)? p[i]:end;
-                    }
-                    if (szgldata(0, s->arg[2]) == 2) {
-                        uint16_t *p = (uint16_t *)s->hshm;
-                        end = (p[i] > end)? p[i]:end;
-                    }
-                    if (szgldata(0, s->arg[2]) == 4) {
-                        uint32_t *p = s->hshm;
-                        end = (p[i] > end)? p[i]:end;
-                    }
-                }
-                start = end;
-                for (int i = 0; i < s->arg[1]; i++) {
-                    if (szgldata(0, s->arg[2]) == 1) {
-                        uint8_t *p = (uint8_t *)s->hshm;
-                        start = (p[i] < start)? p[i]:start;
-                    }
-                    if (szgldata(0, s->arg[2]) == 2) {
-                        uint16_t *p = (uint16_t *)s->hshm;
-                        start = (p[i] < start)? p[i]:start;
-                    }
-                    if (szgldata(0, s->arg[2]) == 4) {
-                        uint32_t *p = s->hshm;
-                        start = (p[i] < start)? p[i]:start;
-                    }
-                }
+                int start, end;
+                elemRange(s->hshm, s->arg[1], szgldata(0, s->arg[2]), &start, &end);
                 //DPRINTF("DrawElements() %04x %04x", start, end);
                 s->elemMax = (end > s->elemMax)? end:s->elemMax;
                 if (s->arrayBuf == 0)
@@ -962,36 +1095,8 @@ static void processArgs(MesaPTState *s)
             if (s->elemArryBuf == 0) {
                 s->datacb = ALIGNED(s->arg[1] * szgldata(0, s->arg[2]));
                 s->parg[3] = VAL(s->hshm);
-                int base, start, end = 0;
-                for (int i = 0; i < s->arg[1]; i++) {
-                    if (szgldata(0, s->arg[2]) == 1) {
-                        uint8_t *p = (uint8_t *)s->hshm;
-                        end = (p[i] > end)? p[i]:end;
-                    }
-                    if (szgldata(0, s->arg[2]) == 2) {
-                        uint16_t *p = (uint16_t *)s->hshm;
-                        end = (p[i] > end)? p[i]:end;
-                    }
-                    if (szgldata(0, s->arg[2]) == 4) {
-                        uint32_t *p = s->hshm;
-                        end = (p[i] > end)? p[i]:end;
-                    }
-                }
-                start = end;
-                for (int i = 0; i < s->arg[1]; i++) {
-                    if (szgldata(0, s->arg[2]) == 1) {
-                        uint8_t *p = (uint8_t *)s->hshm;
-                        start = (p[i] < start)? p[i]:start;
-                    }
-                    if (szgldata(0, s->arg[2]) == 2) {
-                        uint16_t *p = (uint16_t *)s->hshm;
-                        start = (p[i] < start)? p[i]:start;
-                    }
-                    if (szgldata(0, s->arg[2]) == 4) {
-                        uint32_t *p = s->hshm;
-                        start = (p[i] < start)? p[i]:start;
-                    }
-                }
+                int base, start, end;
+                elemRange(s->hshm, s->arg[1], szgldata(0, s->arg[2]), &start, &end);
                 base = (s->FEnum == FEnum_glDrawElementsBaseVertex)? s->arg[4]:s->arg[5];
                 s->elemMax = ((end + base) > s->elemMax)? (end + base):s->elemMax;
                 if (s->arrayBuf == 0)
@@ -1460,7 +1565,7 @@ static void processArgs(MesaPTState *s)
                     (((s->szUnpackWidth == 0)? s->arg[4]:s->szUnpackWidth) * s->arg[5] * szgldata(s->arg[6], s->arg[7]));
                 SZFBT_VALID(szTex, s->arg[8]);
                 texPtr = (uint32_t *)(s->fbtm_ptr + (MGLFBT_SIZE - ALIGNED(szTex)));
-                s->parg[0] = (s->arg[8])? VAL(texPtr):0;
+                s->parg[0] = (s->arg[8])? texUnpackPtr(s, texPtr, szTex):0;
                 //DPRINTF("Tex*Image2D() %x,%x,%x,%x,%x,%x,%x,%x,%08x",s->arg[0],s->arg[1],s->arg[2],s->arg[3],s->arg[4],s->arg[5],s->arg[6],s->arg[7],szTex);
             }
             break;
@@ -1472,7 +1577,7 @@ static void processArgs(MesaPTState *s)
                 szTex = ((s->szUnpackWidth == 0)? s->arg[3]:s->szUnpackWidth) * ((s->szUnpackHeight == 0)? s->arg[4]:s->szUnpackHeight) * s->arg[5] * szgldata(s->arg[7], s->arg[8]);
                 SZFBT_VALID(szTex, s->arg[9]);
                 texPtr = (uint32_t *)(s->fbtm_ptr + (MGLFBT_SIZE - ALIGNED(szTex)));
-                s->parg[1] = (s->arg[9])? VAL(texPtr):0;
+                s->parg[1] = (s->arg[9])? texUnpackPtr(s, texPtr, szTex):0;
             }
             break;
         case FEnum_glTexSubImage3D:
@@ -1483,7 +1588,7 @@ static void processArgs(MesaPTState *s)
                 szTex = ((s->szUnpackWidth == 0)? s->arg[5]:s->szUnpackWidth) * ((s->szUnpackHeight == 0)? s->arg[6]:s->szUnpackHeight) * s->arg[7] * szgldata(s->arg[8], s->arg[9]);
                 SZFBT_VALID(szTex, s->arg[10]);
                 texPtr = (uint32_t *)(s->fbtm_ptr + (MGLFBT_SIZE - ALIGNED(szTex)));
-                s->parg[2] = (s->arg[10])? VAL(texPtr):0;
+                s->parg[2] = (s->arg[10])? texUnpackPtr(s, texPtr, szTex):0;
             }
             break;
         case FEnum_glGetCompressedTexImage:
@@ -1516,7 +1621,7 @@ static void processArgs(MesaPTState *s)
                 uint32_t *texPtr;
                 SZFBT_VALID(s->arg[6], s->arg[7]);
                 texPtr = (uint32_t *)(s->fbtm_ptr + (MGLFBT_SIZE - ALIGNED(s->arg[6])));
-                s->parg[3] = VAL(texPtr);
+                s->parg[3] = texUnpackPtr(s, texPtr, s->arg[6]);
             }
             break;
         case FEnum_glCompressedTexImage3D:
@@ -1528,7 +1633,7 @@ static void processArgs(MesaPTState *s)
                 uint32_t *texPtr;
                 SZFBT_VALID(s->arg[7], s->arg[8]);
                 texPtr = (uint32_t *)(s->fbtm_ptr + (MGLFBT_SIZE - ALIGNED(s->arg[7])));
-                s->parg[0] = VAL(texPtr);
+                s->parg[0] = texUnpackPtr(s, texPtr, s->arg[7]);
             }
             break;
         case FEnum_glCompressedTexSubImage3D:
@@ -1538,7 +1643,7 @@ static void processArgs(MesaPTState *s)
                 uint32_t *texPtr;
                 SZFBT_VALID(s->arg[9], s->arg[10]);
                 texPtr = (uint32_t *)(s->fbtm_ptr + (MGLFBT_SIZE - ALIGNED(s->arg[9])));
-                s->parg[2] = VAL(texPtr);
+                s->parg[2] = texUnpackPtr(s, texPtr, s->arg[9]);
             }
             break;
         case FEnum_glMap1d:
@@ -1831,6 +1936,11 @@ static void processFRet(MesaPTState *s)
 {
     uint8_t *outshm = s->fifo_ptr + (MGLSHM_SIZE - (3*PAGE_SIZE));
 
+    if (s->texPinned) {
+        s->texPinned = 0;
+        wrTexUnpackPinnedDone();
+    }
+
     if (PArgsShouldAligned(s) == 0) {
         s->parg[0] &= ~(sizeof(uintptr_t) - 1);
         s->parg[1] &= ~(sizeof(uintptr_t) - 1);
@@ -1862,6 +1972,11 @@ static void processFRet(MesaPTState *s)
                 s->queryBuf = (((uint32_t *)s->hshm)[i] == s->queryBuf)? 0:s->queryBuf;
                 if ((s->vao == 0) && s->arrayBuf && (((uint32_t *)s->hshm)[i] == s->arrayBuf))
                     vtxarry_ptr_reset(s);
+                do {
+                    mapbufo_t *bo = FindBufObj(((uint32_t *)s->hshm)[i]);
+                    if (bo && MGLUpdateGuestBufo(bo, -1))
+                        FreeBufObj(((uint32_t *)s->hshm)[i]);
+                } while(0);
                 s->arrayBuf = (((uint32_t *)s->hshm)[i] == s->arrayBuf)? 0:s->arrayBuf;
                 s->elemArryBuf = (((uint32_t *)s->hshm)[i] == s->elemArryBuf)? 0:s->elemArryBuf;
             }
@@ -1880,6 +1995,14 @@ static void processFRet(MesaPTState *s)
             }
             s->arrayBuf = s->vao;
             s->elemArryBuf = s->vao;
+            PinVertex(s->vao || s->clientAttribDepth);
+            break;
+        case FEnum_glPushClientAttrib:
+        case FEnum_glPushClientAttribDefaultEXT:
+        case FEnum_glPopClientAttrib:
+            s->clientAttribDepth += (s->FEnum == FEnum_glPopClientAttrib)? -1:1;
+            s->clientAttribDepth = MAX(s->clientAttribDepth, 0);
+            PinVertex(s->vao || s->clientAttribDepth);
             break;
         case FEnum_glClientActiveTexture:
         case FEnum_glClientActiveTextureARB:
@@ -1947,6 +2070,8 @@ static void processFRet(MesaPTState *s)
                 s->szUsedBuf -= (s->szUsedBuf == (s->BufObj->mused + ALIGNBO(s->BufObj->mapsz)))?
                     ALIGNBO(s->BufObj->mapsz):0;
             }
+            /* sticky slots keep the object, it is no longer mapped */
+            s->BufObj->hva = 0;
             s->szUsedBuf = FreeBufObj(s->BufIdx)? s->szUsedBuf:0;
             break;
         case FEnum_glPixelStorei:
@@ -2133,11 +2258,10 @@ static void processFRet(MesaPTState *s)
     }
 }
 
-static void processFifo(MesaPTState *s)
+static void processFifoBatch(MesaPTState *s, uint32_t *fifoptr, uint32_t *dataptr)
 {
-    uint32_t *fifoptr = (uint32_t *)s->fifo_ptr;
-    uint32_t *dataptr = (uint32_t *)(s->fifo_ptr + (MAX_FIFO << 2));
-    int FEnum = s->FEnum, i = FIRST_FIFO, j = ALIGNED(1) >> 2;
+    int FEnum = s->FEnum, i = FIRST_FIFO, j = ALIGNED(1) >> 2,
+        prof = MGLProfileActive(), batch = 0;
     struct {
         uint32_t fifo;
         uint32_t data;
@@ -2169,17 +2293,23 @@ static void processFifo(MesaPTState *s)
             doMesaFunc(s->FEnum, s->arg, s->parg, &(s->FRet));
             processFRet(s);
             numData = (s->datacb & 0x03)? ((s->datacb >> 2) + 1):(s->datacb >> 2);
+            if (prof)
+                MGLProfileFifo(s->FEnum, (numArgs + numData) << 2);
             i += numArgs;
             j += numData;
+            batch++;
         }
 #if DEBUG_FIFO
         if (i != FIRST_FIFO)
             fprintf(stderr, "\n} [%02X] fifo %04x data %d/%d\n", FEnum, i, j, dataptr[0]);
 #endif
+        MGLImmFlush();
         s->fifoMax = (s->fifoMax < i)? i:s->fifoMax;
         fifoptr[0] = FIRST_FIFO;
         s->FEnum = FEnum;
     }
+    if (prof)
+        MGLProfileDoorbell(batch);
     if (GLFifoTrace()) {
         const char *fstr = getGLFuncStr(s->FEnum);
         DPRINTF_COND(fstr, "FIFO depth %s fifoptr %06x dataptr %06x", fstr, fifostat.fifo, fifostat.data);
@@ -2193,19 +2323,703 @@ static void processFifo(MesaPTState *s)
     }
 }
 
+static void processFifo(MesaPTState *s)
+{
+    processFifoBatch(s, (uint32_t *)s->fifo_ptr, (uint32_t *)(s->fifo_ptr + (MAX_FIFO << 2)));
+}
+
+/* Calls that return a value or write back through a pointer argument */
+static int FEnumSyncReq(const uint32_t FEnum)
+{
+    switch (FEnum) {
+        case FEnum_glAcquireKeyedMutexWin32EXT:
+        case FEnum_glAreProgramsResidentNV:
+        case FEnum_glAreTexturesResident:
+        case FEnum_glAreTexturesResidentEXT:
+        case FEnum_glBindLightParameterEXT:
+        case FEnum_glBindMaterialParameterEXT:
+        case FEnum_glBindParameterEXT:
+        case FEnum_glBindTexGenParameterEXT:
+        case FEnum_glBindTextureUnitParameterEXT:
+        case FEnum_glCheckFramebufferStatus:
+        case FEnum_glCheckFramebufferStatusEXT:
+        case FEnum_glCheckNamedFramebufferStatus:
+        case FEnum_glCheckNamedFramebufferStatusEXT:
+        case FEnum_glClientWaitSync:
+        case FEnum_glCreateBuffers:
+        case FEnum_glCreateCommandListsNV:
+        case FEnum_glCreateFramebuffers:
+        case FEnum_glCreateMemoryObjectsEXT:
+        case FEnum_glCreatePerfQueryINTEL:
+        case FEnum_glCreateProgram:
+        case FEnum_glCreateProgramObjectARB:
+        case FEnum_glCreateProgramPipelines:
+        case FEnum_glCreateQueries:
+        case FEnum_glCreateRenderbuffers:
+        case FEnum_glCreateSamplers:
+        case FEnum_glCreateShader:
+        case FEnum_glCreateShaderObjectARB:
+        case FEnum_glCreateShaderProgramEXT:
+        case FEnum_glCreateShaderProgramv:
+        case FEnum_glCreateStatesNV:
+        case FEnum_glCreateSyncFromCLeventARB:
+        case FEnum_glCreateTextures:
+        case FEnum_glCreateTransformFeedbacks:
+        case FEnum_glCreateVertexArrays:
+        case FEnum_glCullParameterdvEXT:
+        case FEnum_glCullParameterfvEXT:
+        case FEnum_glDebugMessageCallbackAMD:
+        case FEnum_glDeletePerfMonitorsAMD:
+        case FEnum_glFeedbackBuffer:
+        case FEnum_glFenceSync:
+        case FEnum_glFinish:
+        case FEnum_glFinishAsyncSGIX:
+        case FEnum_glFlushVertexArrayRangeAPPLE:
+        case FEnum_glGenAsyncMarkersSGIX:
+        case FEnum_glGenBuffers:
+        case FEnum_glGenBuffersARB:
+        case FEnum_glGenFencesAPPLE:
+        case FEnum_glGenFencesNV:
+        case FEnum_glGenFragmentShadersATI:
+        case FEnum_glGenFramebuffers:
+        case FEnum_glGenFramebuffersEXT:
+        case FEnum_glGenLists:
+        case FEnum_glGenNamesAMD:
+        case FEnum_glGenOcclusionQueriesNV:
+        case FEnum_glGenPathsNV:
+        case FEnum_glGenPerfMonitorsAMD:
+        case FEnum_glGenProgramPipelines:
+        case FEnum_glGenProgramsARB:
+        case FEnum_glGenProgramsNV:
+        case FEnum_glGenQueries:
+        case FEnum_glGenQueriesARB:
+        case FEnum_glGenQueryResourceTagNV:
+        case FEnum_glGenRenderbuffers:
+        case FEnum_glGenRenderbuffersEXT:
+        case FEnum_glGenSamplers:
+        case FEnum_glGenSemaphoresEXT:
+        case FEnum_glGenSymbolsEXT:
+        case FEnum_glGenTextures:
+        case FEnum_glGenTexturesEXT:
+        case FEnum_glGenTransformFeedbacks:
+        case FEnum_glGenTransformFeedbacksNV:
+        case FEnum_glGenVertexArrays:
+        case FEnum_glGenVertexArraysAPPLE:
+        case FEnum_glGenVertexShadersEXT:
+        case FEnum_glGetActiveAtomicCounterBufferiv:
+        case FEnum_glGetActiveAttrib:
+        case FEnum_glGetActiveAttribARB:
+        case FEnum_glGetActiveSubroutineName:
+        case FEnum_glGetActiveSubroutineUniformName:
+        case FEnum_glGetActiveSubroutineUniformiv:
+        case FEnum_glGetActiveUniform:
+        case FEnum_glGetActiveUniformARB:
+        case FEnum_glGetActiveUniformBlockName:
+        case FEnum_glGetActiveUniformBlockiv:
+        case FEnum_glGetActiveUniformName:
+        case FEnum_glGetActiveUniformsiv:
+        case FEnum_glGetActiveVaryingNV:
+        case FEnum_glGetArrayObjectfvATI:
+        case FEnum_glGetArrayObjectivATI:
+        case FEnum_glGetAttachedObjectsARB:
+        case FEnum_glGetAttachedShaders:
+        case FEnum_glGetAttribLocation:
+        case FEnum_glGetAttribLocationARB:
+        case FEnum_glGetBooleanIndexedvEXT:
+        case FEnum_glGetBooleani_v:
+        case FEnum_glGetBooleanv:
+        case FEnum_glGetBufferParameteri64v:
+        case FEnum_glGetBufferParameteriv:
+        case FEnum_glGetBufferParameterivARB:
+        case FEnum_glGetBufferParameterui64vNV:
+        case FEnum_glGetBufferPointerv:
+        case FEnum_glGetBufferPointervARB:
+        case FEnum_glGetBufferSubData:
+        case FEnum_glGetBufferSubDataARB:
+        case FEnum_glGetClipPlane:
+        case FEnum_glGetClipPlanefOES:
+        case FEnum_glGetClipPlanexOES:
+        case FEnum_glGetColorTable:
+        case FEnum_glGetColorTableEXT:
+        case FEnum_glGetColorTableParameterfv:
+        case FEnum_glGetColorTableParameterfvEXT:
+        case FEnum_glGetColorTableParameterfvSGI:
+        case FEnum_glGetColorTableParameteriv:
+        case FEnum_glGetColorTableParameterivEXT:
+        case FEnum_glGetColorTableParameterivSGI:
+        case FEnum_glGetColorTableSGI:
+        case FEnum_glGetCombinerInputParameterfvNV:
+        case FEnum_glGetCombinerInputParameterivNV:
+        case FEnum_glGetCombinerOutputParameterfvNV:
+        case FEnum_glGetCombinerOutputParameterivNV:
+        case FEnum_glGetCombinerStageParameterfvNV:
+        case FEnum_glGetCommandHeaderNV:
+        case FEnum_glGetCompressedMultiTexImageEXT:
+        case FEnum_glGetCompressedTexImage:
+        case FEnum_glGetCompressedTexImageARB:
+        case FEnum_glGetCompressedTextureImage:
+        case FEnum_glGetCompressedTextureImageEXT:
+        case FEnum_glGetCompressedTextureSubImage:
+        case FEnum_glGetConvolutionFilter:
+        case FEnum_glGetConvolutionFilterEXT:
+        case FEnum_glGetConvolutionParameterfv:
+        case FEnum_glGetConvolutionParameterfvEXT:
+        case FEnum_glGetConvolutionParameteriv:
+        case FEnum_glGetConvolutionParameterivEXT:
+        case FEnum_glGetConvolutionParameterxvOES:
+        case FEnum_glGetCoverageModulationTableNV:
+        case FEnum_glGetDebugMessageLog:
+        case FEnum_glGetDebugMessageLogAMD:
+        case FEnum_glGetDebugMessageLogARB:
+        case FEnum_glGetDetailTexFuncSGIS:
+        case FEnum_glGetDoubleIndexedvEXT:
+        case FEnum_glGetDoublei_v:
+        case FEnum_glGetDoublei_vEXT:
+        case FEnum_glGetDoublev:
+        case FEnum_glGetError:
+        case FEnum_glGetFenceivNV:
+        case FEnum_glGetFinalCombinerInputParameterfvNV:
+        case FEnum_glGetFinalCombinerInputParameterivNV:
+        case FEnum_glGetFirstPerfQueryIdINTEL:
+        case FEnum_glGetFixedvOES:
+        case FEnum_glGetFloatIndexedvEXT:
+        case FEnum_glGetFloati_v:
+        case FEnum_glGetFloati_vEXT:
+        case FEnum_glGetFloatv:
+        case FEnum_glGetFogFuncSGIS:
+        case FEnum_glGetFragDataIndex:
+        case FEnum_glGetFragDataLocation:
+        case FEnum_glGetFragDataLocationEXT:
+        case FEnum_glGetFragmentLightfvSGIX:
+        case FEnum_glGetFragmentLightivSGIX:
+        case FEnum_glGetFragmentMaterialfvSGIX:
+        case FEnum_glGetFragmentMaterialivSGIX:
+        case FEnum_glGetFramebufferAttachmentParameteriv:
+        case FEnum_glGetFramebufferAttachmentParameterivEXT:
+        case FEnum_glGetFramebufferParameterfvAMD:
+        case FEnum_glGetFramebufferParameteriv:
+        case FEnum_glGetFramebufferParameterivEXT:
+        case FEnum_glGetGraphicsResetStatus:
+        case FEnum_glGetGraphicsResetStatusARB:
+        case FEnum_glGetHandleARB:
+        case FEnum_glGetHistogram:
+        case FEnum_glGetHistogramEXT:
+        case FEnum_glGetHistogramParameterfv:
+        case FEnum_glGetHistogramParameterfvEXT:
+        case FEnum_glGetHistogramParameteriv:
+        case FEnum_glGetHistogramParameterivEXT:
+        case FEnum_glGetHistogramParameterxvOES:
+        case FEnum_glGetImageHandleARB:
+        case FEnum_glGetImageHandleNV:
+        case FEnum_glGetImageTransformParameterfvHP:
+        case FEnum_glGetImageTransformParameterivHP:
+        case FEnum_glGetInfoLogARB:
+        case FEnum_glGetInstrumentsSGIX:
+        case FEnum_glGetInteger64i_v:
+        case FEnum_glGetInteger64v:
+        case FEnum_glGetIntegerIndexedvEXT:
+        case FEnum_glGetIntegeri_v:
+        case FEnum_glGetIntegerui64i_vNV:
+        case FEnum_glGetIntegerui64vNV:
+        case FEnum_glGetIntegerv:
+        case FEnum_glGetInternalformatSampleivNV:
+        case FEnum_glGetInternalformati64v:
+        case FEnum_glGetInternalformativ:
+        case FEnum_glGetInvariantBooleanvEXT:
+        case FEnum_glGetInvariantFloatvEXT:
+        case FEnum_glGetInvariantIntegervEXT:
+        case FEnum_glGetLightfv:
+        case FEnum_glGetLightiv:
+        case FEnum_glGetLightxOES:
+        case FEnum_glGetListParameterfvSGIX:
+        case FEnum_glGetListParameterivSGIX:
+        case FEnum_glGetLocalConstantBooleanvEXT:
+        case FEnum_glGetLocalConstantFloatvEXT:
+        case FEnum_glGetLocalConstantIntegervEXT:
+        case FEnum_glGetMapAttribParameterfvNV:
+        case FEnum_glGetMapAttribParameterivNV:
+        case FEnum_glGetMapControlPointsNV:
+        case FEnum_glGetMapParameterfvNV:
+        case FEnum_glGetMapParameterivNV:
+        case FEnum_glGetMapdv:
+        case FEnum_glGetMapfv:
+        case FEnum_glGetMapiv:
+        case FEnum_glGetMapxvOES:
+        case FEnum_glGetMaterialfv:
+        case FEnum_glGetMaterialiv:
+        case FEnum_glGetMemoryObjectDetachedResourcesuivNV:
+        case FEnum_glGetMemoryObjectParameterivEXT:
+        case FEnum_glGetMinmax:
+        case FEnum_glGetMinmaxEXT:
+        case FEnum_glGetMinmaxParameterfv:
+        case FEnum_glGetMinmaxParameterfvEXT:
+        case FEnum_glGetMinmaxParameteriv:
+        case FEnum_glGetMinmaxParameterivEXT:
+        case FEnum_glGetMultiTexEnvfvEXT:
+        case FEnum_glGetMultiTexEnvivEXT:
+        case FEnum_glGetMultiTexGendvEXT:
+        case FEnum_glGetMultiTexGenfvEXT:
+        case FEnum_glGetMultiTexGenivEXT:
+        case FEnum_glGetMultiTexImageEXT:
+        case FEnum_glGetMultiTexLevelParameterfvEXT:
+        case FEnum_glGetMultiTexLevelParameterivEXT:
+        case FEnum_glGetMultiTexParameterIivEXT:
+        case FEnum_glGetMultiTexParameterIuivEXT:
+        case FEnum_glGetMultiTexParameterfvEXT:
+        case FEnum_glGetMultiTexParameterivEXT:
+        case FEnum_glGetMultisamplefv:
+        case FEnum_glGetMultisamplefvNV:
+        case FEnum_glGetNamedBufferParameteri64v:
+        case FEnum_glGetNamedBufferParameteriv:
+        case FEnum_glGetNamedBufferParameterivEXT:
+        case FEnum_glGetNamedBufferParameterui64vNV:
+        case FEnum_glGetNamedBufferPointerv:
+        case FEnum_glGetNamedBufferPointervEXT:
+        case FEnum_glGetNamedBufferSubData:
+        case FEnum_glGetNamedBufferSubDataEXT:
+        case FEnum_glGetNamedFramebufferAttachmentParameteriv:
+        case FEnum_glGetNamedFramebufferAttachmentParameterivEXT:
+        case FEnum_glGetNamedFramebufferParameterfvAMD:
+        case FEnum_glGetNamedFramebufferParameteriv:
+        case FEnum_glGetNamedFramebufferParameterivEXT:
+        case FEnum_glGetNamedProgramLocalParameterIivEXT:
+        case FEnum_glGetNamedProgramLocalParameterIuivEXT:
+        case FEnum_glGetNamedProgramLocalParameterdvEXT:
+        case FEnum_glGetNamedProgramLocalParameterfvEXT:
+        case FEnum_glGetNamedProgramStringEXT:
+        case FEnum_glGetNamedProgramivEXT:
+        case FEnum_glGetNamedRenderbufferParameteriv:
+        case FEnum_glGetNamedRenderbufferParameterivEXT:
+        case FEnum_glGetNamedStringARB:
+        case FEnum_glGetNamedStringivARB:
+        case FEnum_glGetNextPerfQueryIdINTEL:
+        case FEnum_glGetObjectBufferfvATI:
+        case FEnum_glGetObjectBufferivATI:
+        case FEnum_glGetObjectLabel:
+        case FEnum_glGetObjectLabelEXT:
+        case FEnum_glGetObjectParameterfvARB:
+        case FEnum_glGetObjectParameterivAPPLE:
+        case FEnum_glGetObjectParameterivARB:
+        case FEnum_glGetObjectPtrLabel:
+        case FEnum_glGetOcclusionQueryivNV:
+        case FEnum_glGetOcclusionQueryuivNV:
+        case FEnum_glGetPathColorGenfvNV:
+        case FEnum_glGetPathColorGenivNV:
+        case FEnum_glGetPathCommandsNV:
+        case FEnum_glGetPathCoordsNV:
+        case FEnum_glGetPathDashArrayNV:
+        case FEnum_glGetPathLengthNV:
+        case FEnum_glGetPathMetricRangeNV:
+        case FEnum_glGetPathMetricsNV:
+        case FEnum_glGetPathParameterfvNV:
+        case FEnum_glGetPathParameterivNV:
+        case FEnum_glGetPathSpacingNV:
+        case FEnum_glGetPathTexGenfvNV:
+        case FEnum_glGetPathTexGenivNV:
+        case FEnum_glGetPerfCounterInfoINTEL:
+        case FEnum_glGetPerfMonitorCounterDataAMD:
+        case FEnum_glGetPerfMonitorCounterInfoAMD:
+        case FEnum_glGetPerfMonitorCounterStringAMD:
+        case FEnum_glGetPerfMonitorCountersAMD:
+        case FEnum_glGetPerfMonitorGroupStringAMD:
+        case FEnum_glGetPerfMonitorGroupsAMD:
+        case FEnum_glGetPerfQueryDataINTEL:
+        case FEnum_glGetPerfQueryIdByNameINTEL:
+        case FEnum_glGetPerfQueryInfoINTEL:
+        case FEnum_glGetPixelMapfv:
+        case FEnum_glGetPixelMapuiv:
+        case FEnum_glGetPixelMapusv:
+        case FEnum_glGetPixelMapxv:
+        case FEnum_glGetPixelTexGenParameterfvSGIS:
+        case FEnum_glGetPixelTexGenParameterivSGIS:
+        case FEnum_glGetPixelTransformParameterfvEXT:
+        case FEnum_glGetPixelTransformParameterivEXT:
+        case FEnum_glGetPointerIndexedvEXT:
+        case FEnum_glGetPointeri_vEXT:
+        case FEnum_glGetPointerv:
+        case FEnum_glGetPointervEXT:
+        case FEnum_glGetPolygonStipple:
+        case FEnum_glGetProgramBinary:
+        case FEnum_glGetProgramEnvParameterIivNV:
+        case FEnum_glGetProgramEnvParameterIuivNV:
+        case FEnum_glGetProgramEnvParameterdvARB:
+        case FEnum_glGetProgramEnvParameterfvARB:
+        case FEnum_glGetProgramInfoLog:
+        case FEnum_glGetProgramInterfaceiv:
+        case FEnum_glGetProgramLocalParameterIivNV:
+        case FEnum_glGetProgramLocalParameterIuivNV:
+        case FEnum_glGetProgramLocalParameterdvARB:
+        case FEnum_glGetProgramLocalParameterfvARB:
+        case FEnum_glGetProgramNamedParameterdvNV:
+        case FEnum_glGetProgramNamedParameterfvNV:
+        case FEnum_glGetProgramParameterdvNV:
+        case FEnum_glGetProgramParameterfvNV:
+        case FEnum_glGetProgramPipelineInfoLog:
+        case FEnum_glGetProgramPipelineiv:
+        case FEnum_glGetProgramResourceIndex:
+        case FEnum_glGetProgramResourceLocation:
+        case FEnum_glGetProgramResourceLocationIndex:
+        case FEnum_glGetProgramResourceName:
+        case FEnum_glGetProgramResourcefvNV:
+        case FEnum_glGetProgramResourceiv:
+        case FEnum_glGetProgramStageiv:
+        case FEnum_glGetProgramStringARB:
+        case FEnum_glGetProgramStringNV:
+        case FEnum_glGetProgramSubroutineParameteruivNV:
+        case FEnum_glGetProgramiv:
+        case FEnum_glGetProgramivARB:
+        case FEnum_glGetProgramivNV:
+        case FEnum_glGetQueryIndexediv:
+        case FEnum_glGetQueryObjecti64v:
+        case FEnum_glGetQueryObjecti64vEXT:
+        case FEnum_glGetQueryObjectiv:
+        case FEnum_glGetQueryObjectivARB:
+        case FEnum_glGetQueryObjectui64v:
+        case FEnum_glGetQueryObjectui64vEXT:
+        case FEnum_glGetQueryObjectuiv:
+        case FEnum_glGetQueryObjectuivARB:
+        case FEnum_glGetQueryiv:
+        case FEnum_glGetQueryivARB:
+        case FEnum_glGetRenderbufferParameteriv:
+        case FEnum_glGetRenderbufferParameterivEXT:
+        case FEnum_glGetSamplerParameterIiv:
+        case FEnum_glGetSamplerParameterIuiv:
+        case FEnum_glGetSamplerParameterfv:
+        case FEnum_glGetSamplerParameteriv:
+        case FEnum_glGetSemaphoreParameterui64vEXT:
+        case FEnum_glGetSeparableFilter:
+        case FEnum_glGetSeparableFilterEXT:
+        case FEnum_glGetShaderInfoLog:
+        case FEnum_glGetShaderPrecisionFormat:
+        case FEnum_glGetShaderSource:
+        case FEnum_glGetShaderSourceARB:
+        case FEnum_glGetShaderiv:
+        case FEnum_glGetShadingRateImagePaletteNV:
+        case FEnum_glGetShadingRateSampleLocationivNV:
+        case FEnum_glGetSharpenTexFuncSGIS:
+        case FEnum_glGetStageIndexNV:
+        case FEnum_glGetString:
+        case FEnum_glGetStringi:
+        case FEnum_glGetSubroutineIndex:
+        case FEnum_glGetSubroutineUniformLocation:
+        case FEnum_glGetSynciv:
+        case FEnum_glGetTexBumpParameterfvATI:
+        case FEnum_glGetTexBumpParameterivATI:
+        case FEnum_glGetTexEnvfv:
+        case FEnum_glGetTexEnviv:
+        case FEnum_glGetTexEnvxvOES:
+        case FEnum_glGetTexFilterFuncSGIS:
+        case FEnum_glGetTexGendv:
+        case FEnum_glGetTexGenfv:
+        case FEnum_glGetTexGeniv:
+        case FEnum_glGetTexGenxvOES:
+        case FEnum_glGetTexImage:
+        case FEnum_glGetTexLevelParameterfv:
+        case FEnum_glGetTexLevelParameteriv:
+        case FEnum_glGetTexLevelParameterxvOES:
+        case FEnum_glGetTexParameterIiv:
+        case FEnum_glGetTexParameterIivEXT:
+        case FEnum_glGetTexParameterIuiv:
+        case FEnum_glGetTexParameterIuivEXT:
+        case FEnum_glGetTexParameterPointervAPPLE:
+        case FEnum_glGetTexParameterfv:
+        case FEnum_glGetTexParameteriv:
+        case FEnum_glGetTexParameterxvOES:
+        case FEnum_glGetTextureHandleARB:
+        case FEnum_glGetTextureHandleNV:
+        case FEnum_glGetTextureImage:
+        case FEnum_glGetTextureImageEXT:
+        case FEnum_glGetTextureLevelParameterfv:
+        case FEnum_glGetTextureLevelParameterfvEXT:
+        case FEnum_glGetTextureLevelParameteriv:
+        case FEnum_glGetTextureLevelParameterivEXT:
+        case FEnum_glGetTextureParameterIiv:
+        case FEnum_glGetTextureParameterIivEXT:
+        case FEnum_glGetTextureParameterIuiv:
+        case FEnum_glGetTextureParameterIuivEXT:
+        case FEnum_glGetTextureParameterfv:
+        case FEnum_glGetTextureParameterfvEXT:
+        case FEnum_glGetTextureParameteriv:
+        case FEnum_glGetTextureParameterivEXT:
+        case FEnum_glGetTextureSamplerHandleARB:
+        case FEnum_glGetTextureSamplerHandleNV:
+        case FEnum_glGetTextureSubImage:
+        case FEnum_glGetTrackMatrixivNV:
+        case FEnum_glGetTransformFeedbackVarying:
+        case FEnum_glGetTransformFeedbackVaryingEXT:
+        case FEnum_glGetTransformFeedbackVaryingNV:
+        case FEnum_glGetTransformFeedbacki64_v:
+        case FEnum_glGetTransformFeedbacki_v:
+        case FEnum_glGetTransformFeedbackiv:
+        case FEnum_glGetUniformBlockIndex:
+        case FEnum_glGetUniformBufferSizeEXT:
+        case FEnum_glGetUniformIndices:
+        case FEnum_glGetUniformLocation:
+        case FEnum_glGetUniformLocationARB:
+        case FEnum_glGetUniformOffsetEXT:
+        case FEnum_glGetUniformSubroutineuiv:
+        case FEnum_glGetUniformdv:
+        case FEnum_glGetUniformfv:
+        case FEnum_glGetUniformfvARB:
+        case FEnum_glGetUniformi64vARB:
+        case FEnum_glGetUniformi64vNV:
+        case FEnum_glGetUniformiv:
+        case FEnum_glGetUniformivARB:
+        case FEnum_glGetUniformui64vARB:
+        case FEnum_glGetUniformui64vNV:
+        case FEnum_glGetUniformuiv:
+        case FEnum_glGetUniformuivEXT:
+        case FEnum_glGetUnsignedBytei_vEXT:
+        case FEnum_glGetUnsignedBytevEXT:
+        case FEnum_glGetVariantArrayObjectfvATI:
+        case FEnum_glGetVariantArrayObjectivATI:
+        case FEnum_glGetVariantBooleanvEXT:
+        case FEnum_glGetVariantFloatvEXT:
+        case FEnum_glGetVariantIntegervEXT:
+        case FEnum_glGetVariantPointervEXT:
+        case FEnum_glGetVaryingLocationNV:
+        case FEnum_glGetVertexArrayIndexed64iv:
+        case FEnum_glGetVertexArrayIndexediv:
+        case FEnum_glGetVertexArrayIntegeri_vEXT:
+        case FEnum_glGetVertexArrayIntegervEXT:
+        case FEnum_glGetVertexArrayPointeri_vEXT:
+        case FEnum_glGetVertexArrayPointervEXT:
+        case FEnum_glGetVertexArrayiv:
+        case FEnum_glGetVertexAttribArrayObjectfvATI:
+        case FEnum_glGetVertexAttribArrayObjectivATI:
+        case FEnum_glGetVertexAttribIiv:
+        case FEnum_glGetVertexAttribIivEXT:
+        case FEnum_glGetVertexAttribIuiv:
+        case FEnum_glGetVertexAttribIuivEXT:
+        case FEnum_glGetVertexAttribLdv:
+        case FEnum_glGetVertexAttribLdvEXT:
+        case FEnum_glGetVertexAttribLi64vNV:
+        case FEnum_glGetVertexAttribLui64vARB:
+        case FEnum_glGetVertexAttribLui64vNV:
+        case FEnum_glGetVertexAttribPointerv:
+        case FEnum_glGetVertexAttribPointervARB:
+        case FEnum_glGetVertexAttribPointervNV:
+        case FEnum_glGetVertexAttribdv:
+        case FEnum_glGetVertexAttribdvARB:
+        case FEnum_glGetVertexAttribdvNV:
+        case FEnum_glGetVertexAttribfv:
+        case FEnum_glGetVertexAttribfvARB:
+        case FEnum_glGetVertexAttribfvNV:
+        case FEnum_glGetVertexAttribiv:
+        case FEnum_glGetVertexAttribivARB:
+        case FEnum_glGetVertexAttribivNV:
+        case FEnum_glGetVideoCaptureStreamdvNV:
+        case FEnum_glGetVideoCaptureStreamfvNV:
+        case FEnum_glGetVideoCaptureStreamivNV:
+        case FEnum_glGetVideoCaptureivNV:
+        case FEnum_glGetVideoi64vNV:
+        case FEnum_glGetVideoivNV:
+        case FEnum_glGetVideoui64vNV:
+        case FEnum_glGetVideouivNV:
+        case FEnum_glGetVkProcAddrNV:
+        case FEnum_glGetnColorTable:
+        case FEnum_glGetnColorTableARB:
+        case FEnum_glGetnCompressedTexImage:
+        case FEnum_glGetnCompressedTexImageARB:
+        case FEnum_glGetnConvolutionFilter:
+        case FEnum_glGetnConvolutionFilterARB:
+        case FEnum_glGetnHistogram:
+        case FEnum_glGetnHistogramARB:
+        case FEnum_glGetnMapdv:
+        case FEnum_glGetnMapdvARB:
+        case FEnum_glGetnMapfv:
+        case FEnum_glGetnMapfvARB:
+        case FEnum_glGetnMapiv:
+        case FEnum_glGetnMapivARB:
+        case FEnum_glGetnMinmax:
+        case FEnum_glGetnMinmaxARB:
+        case FEnum_glGetnPixelMapfv:
+        case FEnum_glGetnPixelMapfvARB:
+        case FEnum_glGetnPixelMapuiv:
+        case FEnum_glGetnPixelMapuivARB:
+        case FEnum_glGetnPixelMapusv:
+        case FEnum_glGetnPixelMapusvARB:
+        case FEnum_glGetnPolygonStipple:
+        case FEnum_glGetnPolygonStippleARB:
+        case FEnum_glGetnSeparableFilter:
+        case FEnum_glGetnSeparableFilterARB:
+        case FEnum_glGetnTexImage:
+        case FEnum_glGetnTexImageARB:
+        case FEnum_glGetnUniformdv:
+        case FEnum_glGetnUniformdvARB:
+        case FEnum_glGetnUniformfv:
+        case FEnum_glGetnUniformfvARB:
+        case FEnum_glGetnUniformi64vARB:
+        case FEnum_glGetnUniformiv:
+        case FEnum_glGetnUniformivARB:
+        case FEnum_glGetnUniformui64vARB:
+        case FEnum_glGetnUniformuiv:
+        case FEnum_glGetnUniformuivARB:
+        case FEnum_glImportMemoryWin32HandleEXT:
+        case FEnum_glImportSemaphoreWin32HandleEXT:
+        case FEnum_glImportSyncEXT:
+        case FEnum_glInstrumentsBufferSGIX:
+        case FEnum_glIsAsyncMarkerSGIX:
+        case FEnum_glIsBuffer:
+        case FEnum_glIsBufferARB:
+        case FEnum_glIsBufferResidentNV:
+        case FEnum_glIsCommandListNV:
+        case FEnum_glIsEnabled:
+        case FEnum_glIsEnabledIndexedEXT:
+        case FEnum_glIsEnabledi:
+        case FEnum_glIsFenceAPPLE:
+        case FEnum_glIsFenceNV:
+        case FEnum_glIsFramebuffer:
+        case FEnum_glIsFramebufferEXT:
+        case FEnum_glIsImageHandleResidentARB:
+        case FEnum_glIsImageHandleResidentNV:
+        case FEnum_glIsList:
+        case FEnum_glIsMemoryObjectEXT:
+        case FEnum_glIsNameAMD:
+        case FEnum_glIsNamedBufferResidentNV:
+        case FEnum_glIsNamedStringARB:
+        case FEnum_glIsObjectBufferATI:
+        case FEnum_glIsOcclusionQueryNV:
+        case FEnum_glIsPathNV:
+        case FEnum_glIsPointInFillPathNV:
+        case FEnum_glIsPointInStrokePathNV:
+        case FEnum_glIsProgram:
+        case FEnum_glIsProgramARB:
+        case FEnum_glIsProgramNV:
+        case FEnum_glIsProgramPipeline:
+        case FEnum_glIsQuery:
+        case FEnum_glIsQueryARB:
+        case FEnum_glIsRenderbuffer:
+        case FEnum_glIsRenderbufferEXT:
+        case FEnum_glIsSampler:
+        case FEnum_glIsSemaphoreEXT:
+        case FEnum_glIsShader:
+        case FEnum_glIsStateNV:
+        case FEnum_glIsSync:
+        case FEnum_glIsTexture:
+        case FEnum_glIsTextureEXT:
+        case FEnum_glIsTextureHandleResidentARB:
+        case FEnum_glIsTextureHandleResidentNV:
+        case FEnum_glIsTransformFeedback:
+        case FEnum_glIsTransformFeedbackNV:
+        case FEnum_glIsVariantEnabledEXT:
+        case FEnum_glIsVertexArray:
+        case FEnum_glIsVertexArrayAPPLE:
+        case FEnum_glIsVertexAttribEnabledAPPLE:
+        case FEnum_glMapBuffer:
+        case FEnum_glMapBufferARB:
+        case FEnum_glMapBufferRange:
+        case FEnum_glMapNamedBuffer:
+        case FEnum_glMapNamedBufferEXT:
+        case FEnum_glMapNamedBufferRange:
+        case FEnum_glMapNamedBufferRangeEXT:
+        case FEnum_glMapObjectBufferATI:
+        case FEnum_glMapTexture2DINTEL:
+        case FEnum_glMulticastGetQueryObjecti64vNV:
+        case FEnum_glMulticastGetQueryObjectivNV:
+        case FEnum_glMulticastGetQueryObjectui64vNV:
+        case FEnum_glMulticastGetQueryObjectuivNV:
+        case FEnum_glNewObjectBufferATI:
+        case FEnum_glObjectPurgeableAPPLE:
+        case FEnum_glObjectUnpurgeableAPPLE:
+        case FEnum_glPathGlyphIndexArrayNV:
+        case FEnum_glPathGlyphIndexRangeNV:
+        case FEnum_glPathMemoryGlyphIndexArrayNV:
+        case FEnum_glPointAlongPathNV:
+        case FEnum_glPollAsyncSGIX:
+        case FEnum_glPollInstrumentsSGIX:
+        case FEnum_glQueryMatrixxOES:
+        case FEnum_glQueryResourceNV:
+        case FEnum_glReadPixels:
+        case FEnum_glReadnPixels:
+        case FEnum_glReadnPixelsARB:
+        case FEnum_glReleaseKeyedMutexWin32EXT:
+        case FEnum_glRenderMode:
+        case FEnum_glSelectBuffer:
+        case FEnum_glSelectPerfMonitorCountersAMD:
+        case FEnum_glTestFenceAPPLE:
+        case FEnum_glTestFenceNV:
+        case FEnum_glTestObjectAPPLE:
+        case FEnum_glUnmapBuffer:
+        case FEnum_glUnmapBufferARB:
+        case FEnum_glUnmapNamedBuffer:
+        case FEnum_glUnmapNamedBufferEXT:
+        case FEnum_glVDPAUGetSurfaceivNV:
+        case FEnum_glVDPAUIsSurfaceNV:
+        case FEnum_glVDPAURegisterOutputSurfaceNV:
+        case FEnum_glVDPAURegisterVideoSurfaceNV:
+        case FEnum_glVDPAURegisterVideoSurfaceWithPictureStructureNV:
+        case FEnum_glVertexArrayRangeAPPLE:
+        case FEnum_glVideoCaptureNV:
+            return 1;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static int FEnumRenderAsync(const uint32_t FEnum)
+{
+    switch (FEnum) {
+        /* guest-filled transfer window or buffer object bookkeeping */
+        case FEnum_glBitmap:
+        case FEnum_glBufferData:
+        case FEnum_glBufferDataARB:
+        case FEnum_glBufferStorage:
+        case FEnum_glBufferSubData:
+        case FEnum_glBufferSubDataARB:
+        case FEnum_glNamedBufferData:
+        case FEnum_glNamedBufferDataEXT:
+        case FEnum_glNamedBufferStorage:
+        case FEnum_glNamedBufferStorageEXT:
+        case FEnum_glNamedBufferSubData:
+        case FEnum_glNamedBufferSubDataEXT:
+        case FEnum_glFlushMappedBufferRange:
+        case FEnum_glFlushMappedBufferRangeAPPLE:
+        case FEnum_glFlushMappedNamedBufferRange:
+        case FEnum_glTexImage1D:
+        case FEnum_glTexImage2D:
+        case FEnum_glTexImage3D:
+        case FEnum_glTexImage3DEXT:
+        case FEnum_glTexSubImage1D:
+        case FEnum_glTexSubImage1DEXT:
+        case FEnum_glTexSubImage2D:
+        case FEnum_glTexSubImage2DEXT:
+        case FEnum_glTexSubImage3D:
+        case FEnum_glTexSubImage3DEXT:
+        case FEnum_glCompressedTexImage1D:
+        case FEnum_glCompressedTexImage1DARB:
+        case FEnum_glCompressedTexImage2D:
+        case FEnum_glCompressedTexImage2DARB:
+        case FEnum_glCompressedTexImage3D:
+        case FEnum_glCompressedTexImage3DARB:
+        case FEnum_glCompressedTexSubImage1D:
+        case FEnum_glCompressedTexSubImage1DARB:
+        case FEnum_glCompressedTexSubImage2D:
+        case FEnum_glCompressedTexSubImage2DARB:
+        case FEnum_glCompressedTexSubImage3D:
+        case FEnum_glCompressedTexSubImage3DARB:
+        case FEnum_glDebugMessageInsertARB:
+            return 0;
+        default:
+            break;
+    }
+    return (FEnumSyncReq(FEnum))? 0:1;
+}
+
 static void ContextCreateCommon(MesaPTState *s)
 {
     s->fifoMax = 0; s->dataMax = 0;
     s->szUsedBuf = 0;
+    MGLUpdateGuestBufo(0, -1);
     InitBufObj();
     InitClientStates(s);
     ImplMesaGLReset();
 }
 
-static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
+static void mesapt_write_sync(MesaPTState *s, hwaddr addr, uint64_t val)
 {
     COMMIT_SIGN;
-    MesaPTState *s = opaque;
 
     if (addr == 0xFBC) {
         switch (val) {
@@ -2220,6 +3034,8 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
                 break;
             case 0xD0320:
                 if (s->mglContext) {
+                    if (s->mglCntxCurrent)
+                        ImplMesaGLFree();
                     s->mglContext = 0;
                     MGLDeleteContext(0);
                 }
@@ -2238,7 +3054,10 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
             processFifo(s);
             processArgs(s);
             doMesaFunc(s->FEnum, s->arg, s->parg, &(s->FRet));
+            MGLImmFlush();
             processFRet(s);
+            if (MGLProfileActive())
+                MGLProfileFifo(s->FEnum, (GLFEnumArgsCnt(s->FEnum) << 2) + s->datacb);
             do {
                 uint32_t *dataptr = (uint32_t *)(s->fifo_ptr + (MAX_FIFO << 2));
                 uint32_t numData = (s->datacb & 0x03)? ((s->datacb >> 2) + 1):(s->datacb >> 2);
@@ -2261,6 +3080,12 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
                     "WARN: FIFO data leak 0x%02x %d", s->FEnum, dataptr[0]);
                 dataptr[0] = ALIGNED(1) >> 2;
             } while (0);
+            /* merged glBegin/glEnd blocks belong to this frame and context */
+            MGLImmFlush();
+        }
+        if (addr != 0xFF0) {
+            MGLStateReset();
+            MGLImmReset();
         }
         switch(addr) {
             case 0xFFC:
@@ -2287,9 +3112,11 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
                         DPRINTF("wglMakeCurrent cntx %d curr %d lvl %d", s->mglContext, s->mglCntxCurrent, level);
                         DPRINTF("%sWRAPGL32", (char *)&ptVer[1]);
                         s->mglCntxCurrent = MGLMakeCurrent(ptVer[0], level)? 0:1;
+                        wrTexUnpackPinnedCurrent(ptVer[0]);
                         s->extnYear = GetGLExtYear();
                         s->extnLength = GetGLExtLength();
                         s->szVertCache = GetVertCacheMB() << 19;
+                        s->vtxHash = GetVertCacheHash();
                         if (s->logpname)
                             g_free(s->logpname);
                         s->logpname = g_new0(uint8_t, 0x2000);
@@ -2300,6 +3127,7 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
                         DPRINTF_COND(ContextVsyncOff(), "%s", "ContextVsyncOff");
                         DPRINTF_COND(RenderScalerOff(), "%s", "RenderScalerOff");
                         DPRINTF_COND(GetFpsLimit(), "FpsLimit [ %d FPS ]", GetFpsLimit());
+                        ptpace_config(s->pace, (s->rndrActive)? GLFramePacing():PTPACE_OFF, GetFpsLimit());
                         DPRINTF("VertexArrayCache %dMB", GetVertCacheMB());
                         DPRINTF("DispTimerSched %s", disptmr? strTimerMS:"disabled");
                         DPRINTF("MappedBufferObject %s-copy", MGLUpdateGuestBufo(0, 0)? "Zero":"One");
@@ -2314,6 +3142,7 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
                             "wglMakeCurrent cntx %d curr %d lvl %d", s->mglContext, s->mglCntxCurrent, level);
                         lvl_prev = level;
                         MGLMakeCurrent(ptVer[0], level);
+                        wrTexUnpackPinnedCurrent(ptVer[0]);
                     }
                 } while(0);
                 break;
@@ -2321,6 +3150,8 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
                 DPRINTF("wglDeleteContext cntx %d curr %d lvl %d", s->mglContext, s->mglCntxCurrent, (int)(MESAGL_MAGIC - val));
                 if (s->mglContext && s->mglCntxCurrent && (val == MESAGL_MAGIC)) {
                     s->perfs.last();
+                    ptpace_config(s->pace, PTPACE_OFF, 0);
+                    ImplMesaGLFree();
                     MGLDeleteContext(0);
                     if (s->dispTimer) {
                         timer_del(s->dispTimer);
@@ -2330,20 +3161,35 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
                     s->mglContext = 0;
                     s->mglCntxWGL = 0;
                     s->mglCntxCurrent = 0;
+                    MGLUpdateGuestBufo(0, -1);
+                    vtxarry_ptr_reset(s);
+                    s->Interleaved.ptr = 0;
                     DPRINTF("VertexArrayStats: elemMax %06x vertexCache %04x", s->elemMax, FreeVertex());
+                    DPRINTF("  vertex push copy %u skip %u", s->vtxPushCopy, s->vtxPushSkip);
+                    s->vtxPushCopy = 0;
+                    s->vtxPushSkip = 0;
                     DPRINTF("MGLStats: fifo 0x%07x data 0x%07x", s->fifoMax, s->dataMax);
                 }
-                else
+                else {
+                    wrTexUnpackPinnedDrop(val);
                     MGLDeleteContext(MESAGL_MAGIC - val);
+                }
                 break;
             case 0xFF0:
                 DPRINTF_COND((GLFuncTrace() == 2), ">>>>>>>> wglSwapBuffers <<<<<<<<");
                 s->perfs.stat();
                 do {
                     uint32_t *swapRet = (uint32_t *)(s->fifo_ptr + (MGLSHM_SIZE - ALIGNED(1)));
-                    DPRINTF_COND((SwapFpsLimit(swapRet[0]) && swapRet[0] != 0x7FU),
-                            "Guest GL Swap limit [ %d FPS ]", GetFpsLimit());
-                    swapRet[0] = MGLSwapBuffers()? ((GetFpsLimit() << 1) | 1):0;
+                    if (SwapFpsLimit(swapRet[0])) {
+                        DPRINTF_COND((swapRet[0] != 0x7FU), "Guest GL Swap limit [ %d FPS ]", GetFpsLimit());
+                        ptpace_config(s->pace, (s->rndrActive)? GLFramePacing():PTPACE_OFF, GetFpsLimit());
+                    }
+                    /* host pacing owns the frame rate, no guest side limit */
+                    ptpace_swap_begin(s->pace);
+                    swapRet[0] = MGLSwapBuffers()?
+                        (((ptpace_active(s->pace)? 0:GetFpsLimit()) << 1) | 1):0;
+                    ptpace_swap_end(s->pace);
+                    TrimVertex(s->szVertCache);
                     MGLMouseWarp(swapRet[1]);
                     dispTimerSched(s->dispTimer, &s->crashRC);
                 } while(0);
@@ -2405,6 +3251,10 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
             case 0xFDC:
                 do {
                     uint8_t *func = s->fifo_ptr + (MGLSHM_SIZE - PAGE_SIZE);
+                    if (strncmp((const char *)func, "wglDestroyPbufferARB", 64) == 0) {
+                        uint32_t *argsp = (uint32_t *)(func + ALIGNED((strnlen((const char *)func, 64) + 1)));
+                        wrTexUnpackPinnedDrop(((MESAGL_MAGIC & 0xFFFFFFFU) << 4) | (argsp[0] & (MAX_PBUFFER - 1)));
+                    }
                     MGLFuncHandler((const char *)func);
                     if (strncmp((const char *)func, "wglCreateContextAttribsARB", 64) == 0) {
                         uint32_t *argsp = (uint32_t *)(func + ALIGNED(strnlen((const char *)func, 64)));
@@ -2449,6 +3299,142 @@ static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
         DPRINTF("  *WARN* Unhandled mesapt_write(), addr %08x val %08x", (uint32_t)addr, (uint32_t)val);
 }
 
+static void processRenderBatch(MesaPTState *s, PRNDRJOB job)
+{
+    s->FEnum = job->val;
+    processFifoBatch(s, job->fifo, job->data);
+    processArgs(s);
+    doMesaFunc(s->FEnum, s->arg, s->parg, &(s->FRet));
+    MGLImmFlush();
+    processFRet(s);
+    if (MGLProfileActive())
+        MGLProfileFifo(s->FEnum, (GLFEnumArgsCnt(s->FEnum) << 2) + s->datacb);
+}
+
+static void *mesapt_render_thread(void *opaque)
+{
+    MesaPTState *s = opaque;
+    PRNDRJOB job;
+
+    qemu_mutex_lock(&s->rndrMutex);
+    while (1) {
+        while (!s->rndrHead && !s->rndrQuit)
+            qemu_cond_wait(&s->rndrCond, &s->rndrMutex);
+        if (!s->rndrHead)
+            break;
+        job = s->rndrHead;
+        s->rndrHead = job->next;
+        s->rndrTail = (s->rndrHead)? s->rndrTail:0;
+        s->rndrBusy = 1;
+        qemu_mutex_unlock(&s->rndrMutex);
+
+        ptpace_hold(s->pace);
+        if (job->fifo) {
+            processRenderBatch(s, job);
+            g_free(job->fifo);
+            g_free(job->data);
+        }
+        else
+            mesapt_write_sync(s, job->addr, job->val);
+        g_free(job);
+
+        qemu_mutex_lock(&s->rndrMutex);
+        s->rndrBusy = 0;
+        s->rndrPend--;
+        qemu_cond_broadcast(&s->rndrIdle);
+    }
+    qemu_mutex_unlock(&s->rndrMutex);
+
+    return NULL;
+}
+
+static void rndrQueueJob(MesaPTState *s, PRNDRJOB job)
+{
+    qemu_mutex_lock(&s->rndrMutex);
+    while (s->rndrPend >= MAX_RNDR_PEND)
+        qemu_cond_wait(&s->rndrIdle, &s->rndrMutex);
+    if (s->rndrTail)
+        s->rndrTail->next = job;
+    else
+        s->rndrHead = job;
+    s->rndrTail = job;
+    s->rndrPend++;
+    qemu_cond_signal(&s->rndrCond);
+    qemu_mutex_unlock(&s->rndrMutex);
+}
+
+static void rndrStart(MesaPTState *s)
+{
+    s->rndrHead = 0;
+    s->rndrTail = 0;
+    s->rndrBusy = 0;
+    s->rndrPend = 0;
+    s->rndrQuit = 0;
+    s->rndrAsync = 0;
+    s->rndrSync = 0;
+    qemu_thread_create(&s->rndrThread, "mesapt-render", mesapt_render_thread, s, QEMU_THREAD_JOINABLE);
+    s->rndrActive = 1;
+    DPRINTF("RenderThread started");
+}
+
+static void rndrStop(MesaPTState *s)
+{
+    rndrWaitIdle(s);
+    qemu_mutex_lock(&s->rndrMutex);
+    s->rndrQuit = 1;
+    qemu_cond_signal(&s->rndrCond);
+    qemu_mutex_unlock(&s->rndrMutex);
+    qemu_thread_join(&s->rndrThread);
+    s->rndrActive = 0;
+    DPRINTF("RenderThread stopped, batches async %u sync %u", s->rndrAsync, s->rndrSync);
+}
+
+static void mesapt_write(void *opaque, hwaddr addr, uint64_t val, unsigned size)
+{
+    MesaPTState *s = opaque;
+    PRNDRJOB job;
+
+    if (s->trace && s->traceRecord)
+        pttrace_doorbell(s->trace, addr, val);
+
+    /* headless surface follows the console, sampled under the BQL */
+    if (addr == 0xFF8)
+        MGLHeadlessConsole();
+
+    if (!s->rndrActive && (addr == 0xFF8) && (val == MESAGL_MAGIC) &&
+        s->mglContext && !s->mglCntxCurrent && GLRenderThread())
+        rndrStart(s);
+
+    if (!s->rndrActive) {
+        mesapt_write_sync(s, addr, val);
+        return;
+    }
+
+    job = g_new0(RNDRJOB, 1);
+    job->addr = addr;
+    job->val = val;
+    if ((addr == 0xFC0) && s->mglContext && s->mglCntxCurrent && FEnumRenderAsync(val)) {
+        uint32_t *fifoptr = (uint32_t *)s->fifo_ptr,
+                 *dataptr = (uint32_t *)(s->fifo_ptr + (MAX_FIFO << 2));
+        uint32_t numFifo = MAX(MIN(fifoptr[0], MAX_FIFO), FIRST_FIFO),
+                 numData = MIN(dataptr[0], MAX_DATA);
+        job->fifo = g_memdup2(fifoptr, numFifo * sizeof(uint32_t));
+        job->data = g_malloc0((numData * sizeof(uint32_t)) + PAGE_SIZE);
+        memcpy(job->data, dataptr, numData * sizeof(uint32_t));
+        fifoptr[0] = FIRST_FIFO;
+        dataptr[0] = ALIGNED(1) >> 2;
+        s->rndrAsync++;
+        rndrQueueJob(s, job);
+        return;
+    }
+    s->rndrSync++;
+    rndrQueueJob(s, job);
+    rndrWaitIdle(s);
+
+    if (!s->mglContext || (addr == 0xFBC))
+        rndrStop(s);
+}
+
 static const MemoryRegionOps mesapt_ops = {
     .read = mesapt_read,
     .write = mesapt_write,
@@ -2479,14 +3465,56 @@ static void mesapt_init(Object *obj)
 
     memory_region_init_io(&s->iomem, obj, &mesapt_ops, s, TYPE_MESAPT, PAGE_SIZE);
     sysbus_init_mmio(sbd, &s->iomem);
+
+    qemu_mutex_init(&s->rndrMutex);
+    qemu_cond_init(&s->rndrCond);
+    qemu_cond_init(&s->rndrIdle);
+}
+
+static void mesapt_trace_doorbell(void *opaque, hwaddr addr, uint64_t val)
+{
+    mesapt_write(opaque, addr, val, sizeof(uint32_t));
 }
 
+static uint64_t mesapt_trace_read(void *opaque, hwaddr addr)
+{
+    return mesapt_read(opaque, addr, sizeof(uint32_t));
+}
+
+static const PTTraceOps mesapt_trace_ops = {
+    .doorbell = mesapt_trace_doorbell,
+    .read = mesapt_trace_read,
+};
+
 static void mesapt_realize(DeviceState *dev, Error **errp)
 {
     MesaPTState *s = MESAPT(dev);
+    MemoryRegion *mr[] = { &s->fifo_ram, &s->fbtm_ram };
+
     mesastat(&s->perfs);
+    s->pace = ptpace_new("mesapt");
+    if (s->headless && !MGLHeadlessCfg(s->headless)) {
+        error_setg(errp, "mesapt: headless rendering requires EGL on a Linux host");
+        return;
+    }
+    if (s->traceRecord && s->traceReplay) {
+        error_setg(errp, "mesapt: record and replay are mutually exclusive");
+        return;
+    }
+    if (s->traceRecord)
+        s->trace = pttrace_record(s->traceRecord, PTTRACE_DEV_MESA, mr, ARRAY_SIZE(mr), errp);
+    if (s->traceReplay)
+        s->trace = pttrace_replay(s->traceReplay, PTTRACE_DEV_MESA, mr, ARRAY_SIZE(mr),
+            &mesapt_trace_ops, s, errp);
 }
 
+static Property mesapt_properties[] = {
+    DEFINE_PROP_STRING("record", MesaPTState, traceRecord),
+    DEFINE_PROP_STRING("replay", MesaPTState, traceReplay),
+    DEFINE_PROP_BOOL("headless", MesaPTState, headless, false),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
 static void mesapt_finalize(Object *obj)
 {
     //MesaPTState *s = MESAPT(obj);
@@ -2498,6 +3526,7 @@ static void mesapt_class_init(ObjectClass *klass, void *data)
 
     dc->realize = mesapt_realize;
     dc->reset = mesapt_reset;
+    device_class_set_props(dc, mesapt_properties);
 }
 
 static const TypeInfo mesapt_info = {
@@ -2512,6 +3541,7 @@ static const TypeInfo mesapt_info = {
 static void mesapt_register_type(void)
 {
     type_register_static(&mesapt_info);
+    MGLProfileRegister();
 }
 
 type_init(mesapt_register_type)
@@ -47,6 +47,27 @@ void deactivateSched(const int);
 void deactivateGuiRefSched(void);
 int find_xstr(const char *, const char *);
 
+int MGLHeadlessCfg(const int);
+int MGLHeadless(void);
+void MGLHeadlessConsole(void);
+int MGLGuiFullscreen(int *);
+void MGLRendererStat(const int);
+void *MGLEglGetProc(const char *);
+const char *MGLEglInit(void);
+void MGLEglRelease(void);
+int MGLEglChooseConfig(const int, int *, int *, int *, int *);
+int MGLEglCreateContext(void);
+void MGLEglContextAttribs(uint32_t *);
+void MGLEglDeleteContext(const int);
+int MGLEglMakeCurrent(const int);
+int MGLEglSwapBuffers(void);
+int MGLEglDrawableContext(void);
+int MGLEglPbufferCreate(const int, const int, const int);
+void MGLEglPbufferDestroy(const int);
+int MGLEglPbufferCurrent(const int);
+void MGLEglPbufferCopyTex(const int, const int, const int,
+                          const int, const int, const int, const int);
+
 typedef struct _perfstat {
     void (*stat)(void);
     void (*last)(void);
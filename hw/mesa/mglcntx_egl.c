@@ -0,0 +1,721 @@
+/*
+ * QEMU MESA GL Pass-Through
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/main-loop.h"
+#include "qemu/thread.h"
+#include "ui/console.h"
+
+#include "mesagl_impl.h"
+
+#define DPRINTF(fmt, ...) \
+    do { fprintf(stderr, "glcntx: " fmt "\n" , ## __VA_ARGS__); } while(0)
+
+static int cfg_headless;
+
+int MGLHeadless(void) { return cfg_headless; }
+
+#if defined(CONFIG_LINUX)
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <dlfcn.h>
+
+/*
+ * Headless backend for hosts without a desktop session. The guest
+ * window is stood in by an EGL pbuffer sized to the VGA console, so the
+ * guest keeps its default framebuffer semantics. On swap the frame is
+ * handed to console 0 while the VGA device is held in passthrough,
+ * either as a dma-buf scanout when the display has a GL context
+ * (egl-headless, spice gl=on) or through a plain DisplaySurface for
+ * everything else (vnc, spice, none). The dma-buf is backed by a
+ * renderbuffer, whose name cannot collide with hardcoded guest texture
+ * names, and is fenced so the display never samples a partial frame.
+ */
+#define EGL_FUNC(t,f) \
+    egl.f = (t)dlsym(egl.hDll, "egl" #f)
+
+static struct {
+    void *hDll;
+    PFNEGLGETPROCADDRESSPROC GetProcAddress;
+    PFNEGLGETPLATFORMDISPLAYPROC GetPlatformDisplay;
+    PFNEGLGETDISPLAYPROC GetDisplay;
+    PFNEGLINITIALIZEPROC Initialize;
+    PFNEGLQUERYSTRINGPROC QueryString;
+    PFNEGLBINDAPIPROC BindAPI;
+    PFNEGLCHOOSECONFIGPROC ChooseConfig;
+    PFNEGLGETCONFIGATTRIBPROC GetConfigAttrib;
+    PFNEGLCREATECONTEXTPROC CreateContext;
+    PFNEGLDESTROYCONTEXTPROC DestroyContext;
+    PFNEGLCREATEPBUFFERSURFACEPROC CreatePbufferSurface;
+    PFNEGLDESTROYSURFACEPROC DestroySurface;
+    PFNEGLMAKECURRENTPROC MakeCurrent;
+    PFNEGLGETCURRENTCONTEXTPROC GetCurrentContext;
+    PFNEGLGETCURRENTSURFACEPROC GetCurrentSurface;
+    PFNEGLCREATEIMAGEKHRPROC CreateImageKHR;
+    PFNEGLDESTROYIMAGEKHRPROC DestroyImageKHR;
+    PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC ExportDMABUFImageQueryMESA;
+    PFNEGLEXPORTDMABUFIMAGEMESAPROC ExportDMABUFImageMESA;
+    PFNEGLCREATESYNCKHRPROC CreateSyncKHR;
+    PFNEGLDESTROYSYNCKHRPROC DestroySyncKHR;
+    PFNEGLCLIENTWAITSYNCKHRPROC ClientWaitSyncKHR;
+} egl;
+
+static EGLDisplay   edpy;
+static EGLConfig    ecfg;
+static EGLSurface   esurf;
+static EGLContext   ectx[MAX_LVLCNTX];
+static EGLSurface   PBDC[MAX_PBUFFER];
+static EGLContext   PBRC[MAX_PBUFFER];
+static int          surf_w, surf_h;
+
+/*
+ * Frame hand-off, written by the thread running the GL context and
+ * consumed by a bottom half under the BQL. The console size is also
+ * sampled on the BQL side, the GL thread only reads the cached copy.
+ */
+static struct {
+    QemuMutex mutex;
+    QEMUBH *bh;
+    int active, shown, dirty;
+    int w, h;
+    int con_w, con_h;
+    uint8_t *front, *back;
+    DisplaySurface *surface;
+    int dmabuf;
+    unsigned fbo, rbo;
+    EGLImageKHR image;
+    EGLSyncKHR sync;
+    QemuDmaBuf next, curr;
+} hdl;
+
+static void hdl_console_update(QemuConsole *con)
+{
+    int w = qemu_console_get_width(con, 640),
+        h = qemu_console_get_height(con, 480);
+
+    qemu_mutex_lock(&hdl.mutex);
+    hdl.con_w = w;
+    hdl.con_h = h;
+    qemu_mutex_unlock(&hdl.mutex);
+}
+
+static void hdl_sync_wait(void)
+{
+    if (hdl.sync) {
+        egl.ClientWaitSyncKHR(edpy, hdl.sync, 0, EGL_FOREVER_KHR);
+        egl.DestroySyncKHR(edpy, hdl.sync);
+        hdl.sync = 0;
+    }
+}
+
+static void hdl_release_scanout(QemuConsole *con)
+{
+    if (hdl.curr.fd >= 0) {
+        dpy_gl_release_dmabuf(con, &hdl.curr);
+        dpy_gl_scanout_disable(con);
+        close(hdl.curr.fd);
+        hdl.curr.fd = -1;
+    }
+    if (hdl.next.fd >= 0) {
+        close(hdl.next.fd);
+        hdl.next.fd = -1;
+    }
+}
+
+static void hdl_present(void *opaque)
+{
+    QemuConsole *con = qemu_console_lookup_by_index(0);
+
+    if (!con)
+        return;
+
+    hdl_console_update(con);
+    qemu_mutex_lock(&hdl.mutex);
+    if (hdl.active != hdl.shown) {
+        hdl.shown = hdl.active;
+        if (!hdl.shown)
+            hdl_release_scanout(con);
+        graphic_hw_passthrough(con, hdl.shown);
+        if (!hdl.shown) {
+            hdl.surface = 0;
+            graphic_hw_invalidate(con);
+        }
+    }
+    if (hdl.shown && hdl.dirty) {
+        hdl.dirty = 0;
+        hdl_sync_wait();
+        if (hdl.next.fd >= 0) {
+            if (hdl.curr.fd >= 0) {
+                dpy_gl_release_dmabuf(con, &hdl.curr);
+                close(hdl.curr.fd);
+            }
+            hdl.curr = hdl.next;
+            hdl.next.fd = -1;
+            dpy_gl_scanout_dmabuf(con, &hdl.curr);
+        }
+        if (hdl.curr.fd >= 0)
+            dpy_gl_update(con, 0, 0, hdl.curr.width, hdl.curr.height);
+        else if (hdl.front) {
+            /* the console owns its surface, VGA may have replaced it */
+            DisplaySurface *ds = qemu_console_surface(con);
+            if (!ds || (ds != hdl.surface) ||
+                (surface_width(ds) != hdl.w) || (surface_height(ds) != hdl.h)) {
+                hdl.surface = qemu_create_displaysurface(hdl.w, hdl.h);
+                dpy_gfx_replace_surface(con, hdl.surface);
+                ds = hdl.surface;
+            }
+            for (int y = 0; y < hdl.h; y++)
+                memcpy((uint8_t *)surface_data(ds) + (y * surface_stride(ds)),
+                    hdl.front + ((hdl.h - y - 1) * (hdl.w << 2)), hdl.w << 2);
+            dpy_gfx_update_full(con);
+        }
+    }
+    qemu_mutex_unlock(&hdl.mutex);
+}
+
+static void hdl_export_free(void)
+{
+    MESA_PFN(PFNGLDELETEFRAMEBUFFERSPROC,  glDeleteFramebuffers);
+    MESA_PFN(PFNGLDELETERENDERBUFFERSPROC, glDeleteRenderbuffers);
+
+    qemu_mutex_lock(&hdl.mutex);
+    if (hdl.sync) {
+        egl.DestroySyncKHR(edpy, hdl.sync);
+        hdl.sync = 0;
+    }
+    qemu_mutex_unlock(&hdl.mutex);
+    if (hdl.image) {
+        egl.DestroyImageKHR(edpy, hdl.image);
+        hdl.image = 0;
+    }
+    if (hdl.rbo && (egl.GetCurrentContext() != EGL_NO_CONTEXT)) {
+        PFN_CALL(glDeleteFramebuffers(1, &hdl.fbo));
+        PFN_CALL(glDeleteRenderbuffers(1, &hdl.rbo));
+    }
+    hdl.fbo = 0;
+    hdl.rbo = 0;
+}
+
+static int hdl_export(const int w, const int h)
+{
+    MESA_PFN(PFNGLBINDFRAMEBUFFERPROC,         glBindFramebuffer);
+    MESA_PFN(PFNGLBINDRENDERBUFFERPROC,        glBindRenderbuffer);
+    MESA_PFN(PFNGLFRAMEBUFFERRENDERBUFFERPROC, glFramebufferRenderbuffer);
+    MESA_PFN(PFNGLGENFRAMEBUFFERSPROC,         glGenFramebuffers);
+    MESA_PFN(PFNGLGENRENDERBUFFERSPROC,        glGenRenderbuffers);
+    MESA_PFN(PFNGLGETINTEGERVPROC,             glGetIntegerv);
+    MESA_PFN(PFNGLRENDERBUFFERSTORAGEPROC,     glRenderbufferStorage);
+    QemuDmaBuf next = { .fd = -1 };
+    EGLint stride, offset;
+    EGLuint64KHR modifier;
+    int fourcc, nplanes, rbo_binding, draw_binding;
+
+    hdl_export_free();
+    PFN_CALL(glGetIntegerv(GL_RENDERBUFFER_BINDING, &rbo_binding));
+    PFN_CALL(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_binding));
+    PFN_CALL(glGenRenderbuffers(1, &hdl.rbo));
+    PFN_CALL(glBindRenderbuffer(GL_RENDERBUFFER, hdl.rbo));
+    PFN_CALL(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h));
+    PFN_CALL(glGenFramebuffers(1, &hdl.fbo));
+    PFN_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, hdl.fbo));
+    PFN_CALL(glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        GL_RENDERBUFFER, hdl.rbo));
+    PFN_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_binding));
+    PFN_CALL(glBindRenderbuffer(GL_RENDERBUFFER, rbo_binding));
+    hdl.image = egl.CreateImageKHR(edpy, egl.GetCurrentContext(), EGL_GL_RENDERBUFFER_KHR,
+        (EGLClientBuffer)(uintptr_t)hdl.rbo, NULL);
+    if ((hdl.image == EGL_NO_IMAGE_KHR) ||
+        !egl.ExportDMABUFImageQueryMESA(edpy, hdl.image, &fourcc, &nplanes, &modifier) ||
+        (nplanes != 1) ||
+        !egl.ExportDMABUFImageMESA(edpy, hdl.image, &next.fd, &stride, &offset)) {
+        DPRINTF("Headless dma-buf export failed, falling back to readback");
+        hdl.image = (hdl.image == EGL_NO_IMAGE_KHR)? 0:hdl.image;
+        hdl_export_free();
+        hdl.dmabuf = 0;
+        return 0;
+    }
+    next.width = next.backing_width = w;
+    next.height = next.backing_height = h;
+    next.stride = stride;
+    next.fourcc = fourcc;
+    next.modifier = modifier;
+    next.y0_top = false;
+
+    qemu_mutex_lock(&hdl.mutex);
+    if (hdl.next.fd >= 0)
+        close(hdl.next.fd);
+    hdl.next = next;
+    hdl.w = w;
+    hdl.h = h;
+    qemu_mutex_unlock(&hdl.mutex);
+    return 1;
+}
+
+static void hdl_frame(void)
+{
+    MESA_PFN(PFNGLBINDBUFFERPROC,        glBindBuffer);
+    MESA_PFN(PFNGLBINDFRAMEBUFFERPROC,   glBindFramebuffer);
+    MESA_PFN(PFNGLBLITFRAMEBUFFERPROC,   glBlitFramebuffer);
+    MESA_PFN(PFNGLFINISHPROC,            glFinish);
+    MESA_PFN(PFNGLFLUSHPROC,             glFlush);
+    MESA_PFN(PFNGLGETINTEGERVPROC,       glGetIntegerv);
+    MESA_PFN(PFNGLPIXELSTOREIPROC,       glPixelStorei);
+    MESA_PFN(PFNGLREADBUFFERPROC,        glReadBuffer);
+    MESA_PFN(PFNGLREADPIXELSPROC,        glReadPixels);
+    static const int pack_states[] = {
+        GL_PACK_SWAP_BYTES,
+        GL_PACK_LSB_FIRST,
+        GL_PACK_ROW_LENGTH,
+        GL_PACK_SKIP_ROWS,
+        GL_PACK_SKIP_PIXELS,
+        GL_PACK_ALIGNMENT,
+        0,
+    };
+    int read_binding, read_buffer, pack_binding, draw_binding,
+        pack[ARRAY_SIZE(pack_states)];
+    const int w = surf_w, h = surf_h;
+
+    PFN_CALL(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_binding));
+    PFN_CALL(glGetIntegerv(GL_READ_BUFFER, &read_buffer));
+    PFN_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+    PFN_CALL(glReadBuffer(GL_BACK));
+
+    if (hdl.dmabuf) {
+        if (hdl.image && ((hdl.w != w) || (hdl.h != h)))
+            hdl_export_free();
+        if (hdl.image || hdl_export(w, h)) {
+            EGLSyncKHR sync = 0;
+            PFN_CALL(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_binding));
+            PFN_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, hdl.fbo));
+            PFN_CALL(glBlitFramebuffer(0,0,w,h, 0,0,w,h, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+            PFN_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_binding));
+            /* the display waits on the fence before it samples the frame */
+            if (egl.CreateSyncKHR)
+                sync = egl.CreateSyncKHR(edpy, EGL_SYNC_FENCE_KHR, NULL);
+            if (sync != EGL_NO_SYNC_KHR) {
+                PFN_CALL(glFlush());
+                qemu_mutex_lock(&hdl.mutex);
+                if (hdl.sync)
+                    egl.DestroySyncKHR(edpy, hdl.sync);
+                hdl.sync = sync;
+                qemu_mutex_unlock(&hdl.mutex);
+            }
+            else
+                PFN_CALL(glFinish());
+        }
+    }
+    if (!hdl.dmabuf) {
+        hdl.back = g_realloc(hdl.back, (w * h) << 2);
+        PFN_CALL(glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &pack_binding));
+        PFN_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        for (int i = 0; pack_states[i]; i++) {
+            PFN_CALL(glGetIntegerv(pack_states[i], &pack[i]));
+            PFN_CALL(glPixelStorei(pack_states[i], (pack_states[i] == GL_PACK_ALIGNMENT)? 4:0));
+        }
+        PFN_CALL(glReadPixels(0,0, w,h, GL_BGRA, GL_UNSIGNED_BYTE, hdl.back));
+        for (int i = 0; pack_states[i]; i++)
+            PFN_CALL(glPixelStorei(pack_states[i], pack[i]));
+        PFN_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, pack_binding));
+
+        qemu_mutex_lock(&hdl.mutex);
+        uint8_t *p = hdl.front;
+        hdl.front = hdl.back;
+        hdl.back = p;
+        hdl.w = w;
+        hdl.h = h;
+        qemu_mutex_unlock(&hdl.mutex);
+    }
+    PFN_CALL(glReadBuffer(read_buffer));
+    PFN_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, read_binding));
+
+    qemu_mutex_lock(&hdl.mutex);
+    hdl.dirty = 1;
+    qemu_mutex_unlock(&hdl.mutex);
+    qemu_bh_schedule(hdl.bh);
+}
+
+static void hdl_console_size(int *w, int *h)
+{
+    qemu_mutex_lock(&hdl.mutex);
+    *w = hdl.con_w;
+    *h = hdl.con_h;
+    qemu_mutex_unlock(&hdl.mutex);
+}
+
+void MGLHeadlessConsole(void)
+{
+    QemuConsole *con = qemu_console_lookup_by_index(0);
+
+    if (cfg_headless && con)
+        hdl_console_update(con);
+}
+
+void *MGLEglGetProc(const char *proc)
+{
+    return (egl.GetProcAddress)? (void *)egl.GetProcAddress(proc):0;
+}
+
+const char *MGLEglInit(void)
+{
+    QemuConsole *con = qemu_console_lookup_by_index(0);
+    const char *xstr;
+
+    if (!egl.hDll) {
+        egl.hDll = dlopen("libEGL.so.1", RTLD_NOW);
+        if (!egl.hDll) {
+            DPRINTF("Headless libEGL.so.1 not found");
+            return 0;
+        }
+        EGL_FUNC(PFNEGLGETPROCADDRESSPROC,       GetProcAddress);
+        EGL_FUNC(PFNEGLGETPLATFORMDISPLAYPROC,   GetPlatformDisplay);
+        EGL_FUNC(PFNEGLGETDISPLAYPROC,           GetDisplay);
+        EGL_FUNC(PFNEGLINITIALIZEPROC,           Initialize);
+        EGL_FUNC(PFNEGLQUERYSTRINGPROC,          QueryString);
+        EGL_FUNC(PFNEGLBINDAPIPROC,              BindAPI);
+        EGL_FUNC(PFNEGLCHOOSECONFIGPROC,         ChooseConfig);
+        EGL_FUNC(PFNEGLGETCONFIGATTRIBPROC,      GetConfigAttrib);
+        EGL_FUNC(PFNEGLCREATECONTEXTPROC,        CreateContext);
+        EGL_FUNC(PFNEGLDESTROYCONTEXTPROC,       DestroyContext);
+        EGL_FUNC(PFNEGLCREATEPBUFFERSURFACEPROC, CreatePbufferSurface);
+        EGL_FUNC(PFNEGLDESTROYSURFACEPROC,       DestroySurface);
+        EGL_FUNC(PFNEGLMAKECURRENTPROC,          MakeCurrent);
+        EGL_FUNC(PFNEGLGETCURRENTCONTEXTPROC,    GetCurrentContext);
+        EGL_FUNC(PFNEGLGETCURRENTSURFACEPROC,    GetCurrentSurface);
+    }
+    if (!edpy) {
+        xstr = egl.QueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (egl.GetPlatformDisplay && find_xstr(xstr, "EGL_MESA_platform_surfaceless"))
+            edpy = egl.GetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (edpy == EGL_NO_DISPLAY)
+            edpy = egl.GetDisplay(EGL_DEFAULT_DISPLAY);
+        if ((edpy == EGL_NO_DISPLAY) || !egl.Initialize(edpy, NULL, NULL) ||
+            !egl.BindAPI(EGL_OPENGL_API)) {
+            DPRINTF("Headless EGL display init failed");
+            edpy = 0;
+            return 0;
+        }
+        xstr = egl.QueryString(edpy, EGL_EXTENSIONS);
+        if (find_xstr(xstr, "EGL_KHR_image_base") &&
+            find_xstr(xstr, "EGL_KHR_gl_renderbuffer_image") &&
+            find_xstr(xstr, "EGL_MESA_image_dma_buf_export")) {
+            egl.CreateImageKHR = (PFNEGLCREATEIMAGEKHRPROC)
+                MGLEglGetProc("eglCreateImageKHR");
+            egl.DestroyImageKHR = (PFNEGLDESTROYIMAGEKHRPROC)
+                MGLEglGetProc("eglDestroyImageKHR");
+            egl.ExportDMABUFImageQueryMESA = (PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC)
+                MGLEglGetProc("eglExportDMABUFImageQueryMESA");
+            egl.ExportDMABUFImageMESA = (PFNEGLEXPORTDMABUFIMAGEMESAPROC)
+                MGLEglGetProc("eglExportDMABUFImageMESA");
+        }
+        if (find_xstr(xstr, "EGL_KHR_fence_sync")) {
+            egl.CreateSyncKHR = (PFNEGLCREATESYNCKHRPROC)
+                MGLEglGetProc("eglCreateSyncKHR");
+            egl.DestroySyncKHR = (PFNEGLDESTROYSYNCKHRPROC)
+                MGLEglGetProc("eglDestroySyncKHR");
+            egl.ClientWaitSyncKHR = (PFNEGLCLIENTWAITSYNCKHRPROC)
+                MGLEglGetProc("eglClientWaitSyncKHR");
+            if (!egl.DestroySyncKHR || !egl.ClientWaitSyncKHR)
+                egl.CreateSyncKHR = 0;
+        }
+        DPRINTF("Headless EGL %s %s", egl.QueryString(edpy, EGL_VENDOR),
+            egl.QueryString(edpy, EGL_VERSION));
+    }
+    hdl.dmabuf = (con && console_has_gl(con) && egl.CreateImageKHR && egl.DestroyImageKHR &&
+        egl.ExportDMABUFImageQueryMESA && egl.ExportDMABUFImageMESA)? 1:0;
+
+    return egl.QueryString(edpy, EGL_EXTENSIONS);
+}
+
+void MGLEglRelease(void)
+{
+    if (esurf) {
+        egl.MakeCurrent(edpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        egl.DestroySurface(edpy, esurf);
+        esurf = 0;
+    }
+    surf_w = 0;
+    surf_h = 0;
+    g_free(hdl.back);
+    hdl.back = 0;
+}
+
+int MGLEglChooseConfig(const int msaa, int *alpha, int *depth, int *stencil, int *samples)
+{
+    EGLint ca[] = {
+        EGL_SURFACE_TYPE    , EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE , EGL_OPENGL_BIT,
+        EGL_RED_SIZE        , 8,
+        EGL_GREEN_SIZE      , 8,
+        EGL_BLUE_SIZE       , 8,
+        EGL_ALPHA_SIZE      , 8,
+        EGL_DEPTH_SIZE      , 24,
+        EGL_STENCIL_SIZE    , 8,
+        EGL_SAMPLE_BUFFERS  , (msaa)? 1:0,
+        EGL_SAMPLES         , (msaa)? msaa:0,
+        EGL_NONE
+    };
+    EGLint n = 0, id = 0;
+
+    if (!edpy)
+        return 0;
+    if (!egl.ChooseConfig(edpy, ca, &ecfg, 1, &n) || !n) {
+        ca[17] = 0;
+        ca[19] = 0;
+        if (!msaa || !egl.ChooseConfig(edpy, ca, &ecfg, 1, &n) || !n) {
+            DPRINTF("Headless EGLConfig not found");
+            return 0;
+        }
+    }
+    egl.GetConfigAttrib(edpy, ecfg, EGL_CONFIG_ID, &id);
+    egl.GetConfigAttrib(edpy, ecfg, EGL_ALPHA_SIZE, alpha);
+    egl.GetConfigAttrib(edpy, ecfg, EGL_DEPTH_SIZE, depth);
+    egl.GetConfigAttrib(edpy, ecfg, EGL_STENCIL_SIZE, stencil);
+    egl.GetConfigAttrib(edpy, ecfg, EGL_SAMPLE_BUFFERS, &samples[0]);
+    egl.GetConfigAttrib(edpy, ecfg, EGL_SAMPLES, &samples[1]);
+    DPRINTF("EGLConfig 0x%03x nSamples %d %d %s %s", id, samples[0], samples[1],
+        (hdl.dmabuf)? "dma-buf":"readback", ContextUseSRGB()? "sRGB":"");
+    return 1;
+}
+
+static void egl_destroy_levels(const int first)
+{
+    egl.MakeCurrent(edpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    for (int i = MAX_LVLCNTX; i > first;) {
+        if (ectx[--i]) {
+            egl.DestroyContext(edpy, ectx[i]);
+            ectx[i] = 0;
+        }
+    }
+}
+
+int MGLEglCreateContext(void)
+{
+    egl_destroy_levels(0);
+    ectx[0] = egl.CreateContext(edpy, ecfg, EGL_NO_CONTEXT, NULL);
+    return (ectx[0] != EGL_NO_CONTEXT)? 0:1;
+}
+
+void MGLEglContextAttribs(uint32_t *argsp)
+{
+    const int *wa = (const int *)&argsp[2];
+    EGLint ca[16];
+    uint32_t i;
+    int k = 0;
+
+    /* WGL_ARB_create_context to EGL_KHR_create_context */
+    for (int j = 0; wa[j] && (k < (ARRAY_SIZE(ca) - 4)); j += 2) {
+        switch (wa[j]) {
+            case 0x2091: /* WGL_CONTEXT_MAJOR_VERSION_ARB */
+                ca[k++] = EGL_CONTEXT_MAJOR_VERSION;
+                ca[k++] = wa[j + 1];
+                break;
+            case 0x2092: /* WGL_CONTEXT_MINOR_VERSION_ARB */
+                ca[k++] = EGL_CONTEXT_MINOR_VERSION;
+                ca[k++] = wa[j + 1];
+                break;
+            case 0x9126: /* WGL_CONTEXT_PROFILE_MASK_ARB */
+                ca[k++] = EGL_CONTEXT_OPENGL_PROFILE_MASK;
+                ca[k++] = wa[j + 1];
+                break;
+            case 0x2094: /* WGL_CONTEXT_FLAGS_ARB */
+                ca[k++] = EGL_CONTEXT_OPENGL_DEBUG;
+                ca[k++] = (wa[j + 1] & 0x01)? EGL_TRUE:EGL_FALSE;
+                ca[k++] = EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE;
+                ca[k++] = (wa[j + 1] & 0x02)? EGL_TRUE:EGL_FALSE;
+                break;
+            default:
+                break;
+        }
+    }
+    ca[k] = EGL_NONE;
+
+    for (i = 0; ((i < MAX_LVLCNTX) && ectx[i]); i++);
+    argsp[1] = (argsp[0])? i:0;
+    if (argsp[1] == 0) {
+        egl_destroy_levels(0);
+        MGLActivateHandler(0, 0);
+        ectx[0] = egl.CreateContext(edpy, ecfg, EGL_NO_CONTEXT, ca);
+        argsp[0] = (ectx[0] != EGL_NO_CONTEXT)? 1:0;
+    }
+    else {
+        if (i == MAX_LVLCNTX) {
+            egl.DestroyContext(edpy, ectx[1]);
+            for (i = 1; i < (MAX_LVLCNTX - 1); i++)
+                ectx[i] = ectx[i + 1];
+            argsp[1] = i;
+        }
+        ectx[i] = egl.CreateContext(edpy, ecfg, ectx[i - 1], ca);
+        argsp[0] = (ectx[i] != EGL_NO_CONTEXT)? 1:0;
+    }
+}
+
+void MGLEglDeleteContext(const int n)
+{
+    if (n == 0) {
+        hdl_export_free();
+        egl_destroy_levels(1);
+        MesaBlitFree();
+    }
+    else
+        egl.MakeCurrent(edpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (ectx[n])
+        egl.DestroyContext(edpy, ectx[n]);
+    ectx[n] = 0;
+}
+
+int MGLEglMakeCurrent(const int n)
+{
+    int w, h;
+
+    hdl_console_size(&w, &h);
+    if (!esurf || (w != surf_w) || (h != surf_h)) {
+        const EGLint pa[] = { EGL_WIDTH, w, EGL_HEIGHT, h, EGL_NONE };
+        egl.MakeCurrent(edpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (esurf)
+            egl.DestroySurface(edpy, esurf);
+        esurf = egl.CreatePbufferSurface(edpy, ecfg, pa);
+        surf_w = (esurf != EGL_NO_SURFACE)? w:0;
+        surf_h = (esurf != EGL_NO_SURFACE)? h:0;
+        DPRINTF("Headless surface %dx%d", surf_w, surf_h);
+    }
+    return egl.MakeCurrent(edpy, esurf, esurf, ectx[n])? 0:1;
+}
+
+int MGLEglSwapBuffers(void)
+{
+    if (surf_w && surf_h)
+        hdl_frame();
+    return 1;
+}
+
+int MGLEglDrawableContext(void)
+{
+    return (ectx[0] && (ectx[0] == egl.GetCurrentContext()));
+}
+
+int MGLEglPbufferCreate(const int i, const int w, const int h)
+{
+    const EGLint pa[] = { EGL_WIDTH, w, EGL_HEIGHT, h, EGL_NONE };
+
+    PBDC[i] = egl.CreatePbufferSurface(edpy, ecfg, pa);
+    PBRC[i] = egl.CreateContext(edpy, ecfg, egl.GetCurrentContext(), NULL);
+    return (PBDC[i] != EGL_NO_SURFACE) && (PBRC[i] != EGL_NO_CONTEXT);
+}
+
+void MGLEglPbufferDestroy(const int i)
+{
+    if (PBRC[i])
+        egl.DestroyContext(edpy, PBRC[i]);
+    if (PBDC[i])
+        egl.DestroySurface(edpy, PBDC[i]);
+    PBRC[i] = 0;
+    PBDC[i] = 0;
+}
+
+int MGLEglPbufferCurrent(const int i)
+{
+    return egl.MakeCurrent(edpy, PBDC[i], PBDC[i], PBRC[i])? 0:1;
+}
+
+void MGLEglPbufferCopyTex(const int i, const int binding, const int target,
+                          const int level, const int format, const int w, const int h)
+{
+    MESA_PFN(PFNGLBINDTEXTUREPROC,    glBindTexture);
+    MESA_PFN(PFNGLCOPYTEXIMAGE2DPROC, glCopyTexImage2D);
+    MESA_PFN(PFNGLGETINTEGERVPROC,    glGetIntegerv);
+    EGLContext prev_context = egl.GetCurrentContext();
+    EGLSurface prev_draw = egl.GetCurrentSurface(EGL_DRAW),
+               prev_read = egl.GetCurrentSurface(EGL_READ);
+    int prev_binded_texture = 0;
+
+    PFN_CALL(glGetIntegerv(binding, &prev_binded_texture));
+    egl.MakeCurrent(edpy, PBDC[i], PBDC[i], PBRC[i]);
+    PFN_CALL(glBindTexture(target, prev_binded_texture));
+    PFN_CALL(glCopyTexImage2D(target, level, format, 0, 0, w, h, 0));
+    egl.MakeCurrent(edpy, prev_draw, prev_read, prev_context);
+}
+
+int MGLHeadlessCfg(const int on)
+{
+    if (on && !hdl.bh) {
+        qemu_mutex_init(&hdl.mutex);
+        hdl.bh = qemu_bh_new(hdl_present, &hdl);
+        hdl.next.fd = -1;
+        hdl.curr.fd = -1;
+        hdl.con_w = 640;
+        hdl.con_h = 480;
+    }
+    cfg_headless = on;
+    return cfg_headless;
+}
+
+int MGLGuiFullscreen(int *sizev)
+{
+    if (!cfg_headless)
+        return mesa_gui_fullscreen(sizev);
+    if (sizev) {
+        if (!surf_w || !surf_h)
+            hdl_console_size(&sizev[0], &sizev[1]);
+        else {
+            sizev[0] = surf_w;
+            sizev[1] = surf_h;
+        }
+        sizev[2] = sizev[0];
+        sizev[3] = sizev[1];
+    }
+    return 0;
+}
+
+void MGLRendererStat(const int activate)
+{
+    if (!cfg_headless) {
+        mesa_renderer_stat(activate);
+        return;
+    }
+    qemu_mutex_lock(&hdl.mutex);
+    hdl.active = activate;
+    qemu_mutex_unlock(&hdl.mutex);
+    qemu_bh_schedule(hdl.bh);
+}
+
+#else /* !CONFIG_LINUX */
+
+int MGLHeadlessCfg(const int on)
+{
+    cfg_headless = 0;
+    return cfg_headless;
+}
+
+void MGLHeadlessConsole(void)
+{
+}
+
+int MGLGuiFullscreen(int *sizev)
+{
+    return mesa_gui_fullscreen(sizev);
+}
+
+void MGLRendererStat(const int activate)
+{
+    mesa_renderer_stat(activate);
+}
+
+#endif /* CONFIG_LINUX */
@@ -43,13 +43,10 @@ int MGLUpdateGuestBufo(mapbufo_t *bufo, int add)
 {
     int ret = GetBufOAccelEN()? kvm_enabled():0;
 
-    if (ret && bufo) {
-        bufo->lvl = (add)? MapBufObjGpa(bufo):0;
-        kvm_update_guest_pa_range(MBUFO_BASE | (bufo->gpa & ((MBUFO_SIZE - 1) - (qemu_real_host_page_size() - 1))),
-            bufo->mapsz + (bufo->hva & (qemu_real_host_page_size() - 1)),
-            (void *)(bufo->hva & qemu_real_host_page_mask()),
-            (bufo->acc & GL_MAP_WRITE_BIT)? 0:1, add);
-    }
+    if (ret && bufo)
+        ret = UpdateBufObjSlot(bufo, add, (GetBufOAccelEN() > 1), kvm_update_guest_pa_range);
+    else if (ret && (add < 0))
+        PurgeBufObjSlot(kvm_update_guest_pa_range);
 
     return ret;
 }
@@ -319,11 +316,21 @@ void SetMesaFuncPtr(void *p)
 
 void *MesaGLGetProc(const char *proc)
 {
+    if (MGLHeadless())
+        return MGLEglGetProc(proc);
     return (void *)glXGetProcAddress((const GLubyte *)proc);
 }
 
 void MGLTmpContext(void)
 {
+    if (MGLHeadless()) {
+        MGLEglInit();
+        xcstr = "";
+        xstr = 0;
+        xglFuncs.SwapIntervalEXT = 0;
+        xglFuncs.GetSwapIntervalEXT = 0;
+        return;
+    }
     Display *tmpDisp = XOpenDisplay(NULL);
     xcstr = glXGetClientString(tmpDisp, GLX_VENDOR);
     xstr = glXQueryExtensionsString(tmpDisp, DefaultScreen(tmpDisp));
@@ -343,6 +350,12 @@ void MGLTmpContext(void)
 void MGLDeleteContext(int level)
 {
     int n = (level)? ((level % MAX_LVLCNTX)? (level % MAX_LVLCNTX):1):level;
+    if (MGLHeadless()) {
+        MGLEglDeleteContext(n);
+        if (!n)
+            MGLActivateHandler(0, 0);
+        return;
+    }
     glXMakeContextCurrent(dpy, None, None, NULL);
     if (n == 0) {
         for (int i = MAX_LVLCNTX; i > 1;) {
@@ -361,6 +374,10 @@ void MGLDeleteContext(int level)
 
 void MGLWndRelease(void)
 {
+    if (MGLHeadless() && wnd_ready) {
+        MGLEglRelease();
+        wnd_ready = 0;
+    }
     if (win) {
         MesaInitGammaRamp();
         XFree(xvi);
@@ -379,6 +396,8 @@ int MGLCreateContext(uint32_t gDC)
     if (gDC == ((MESAGL_HPBDC & 0xFFFFFFF0U) | i)) {
         ret = 0;
     }
+    else if (MGLHeadless())
+        ret = MGLEglCreateContext();
     else {
         glXMakeContextCurrent(dpy, None, None, NULL);
         for (i = MAX_LVLCNTX; i > 0;) {
@@ -398,7 +417,10 @@ int MGLMakeCurrent(uint32_t cntxRC, int level)
     int n = (level)? ((level % MAX_LVLCNTX)? (level % MAX_LVLCNTX):1):level;
     uint32_t i = cntxRC & (MAX_PBUFFER - 1);
     if (cntxRC == (MESAGL_MAGIC - n)) {
-        glXMakeContextCurrent(dpy, win, win, ctx[n]);
+        if (MGLHeadless())
+            MGLEglMakeCurrent(n);
+        else
+            glXMakeContextCurrent(dpy, win, win, ctx[n]);
         InitMesaGLExt();
         wrContextSRGB(ContextUseSRGB());
         if (ContextVsyncOff()) {
@@ -415,8 +437,12 @@ int MGLMakeCurrent(uint32_t cntxRC, int level)
         if (!n)
             MGLActivateHandler(1, 0);
     }
-    if (cntxRC == (((MESAGL_MAGIC & 0xFFFFFFFU) << 4) | i))
-        glXMakeContextCurrent(dpy, PBDC[i], PBDC[i], PBRC[i]);
+    if (cntxRC == (((MESAGL_MAGIC & 0xFFFFFFFU) << 4) | i)) {
+        if (MGLHeadless())
+            MGLEglPbufferCurrent(i);
+        else
+            glXMakeContextCurrent(dpy, PBDC[i], PBDC[i], PBRC[i]);
+    }
 
     return 0;
 }
@@ -425,6 +451,8 @@ int MGLSwapBuffers(void)
 {
     MGLActivateHandler(1, 0);
     MesaBlitScale();
+    if (MGLHeadless())
+        return MGLEglSwapBuffers();
     glXSwapBuffers(dpy, win);
     return 1;
 }
@@ -432,6 +460,14 @@ int MGLSwapBuffers(void)
 static int MGLPresetPixelFormat(void)
 {
     const char nvstr[] = "NVIDIA ";
+    if (MGLHeadless()) {
+        wnd_ready = 0;
+        ImplMesaGLReset();
+        cAuxBuffers = 0;
+        wnd_ready = MGLEglChooseConfig(GetContextMSAA(), &cAlphaBits, &cDepthBits,
+            &cStencilBits, cSampleBuf);
+        return wnd_ready;
+    }
     dpy = XOpenDisplay(NULL);
     wnd_ready = 0;
     ImplMesaGLReset();
@@ -462,10 +498,13 @@ static int MGLPresetPixelFormat(void)
     return 1;
 }
 
+#define PIXEL_FORMAT_PRESET \
+    ((MGLHeadless())? wnd_ready:(xvi != 0))
+
 int MGLChoosePixelFormat(void)
 {
     DPRINTF("ChoosePixelFormat()");
-    if (xvi == 0)
+    if (!PIXEL_FORMAT_PRESET)
         return MGLPresetPixelFormat();
     return 1;
 }
@@ -473,7 +512,7 @@ int MGLChoosePixelFormat(void)
 int MGLSetPixelFormat(int fmt, const void *p)
 {
     DPRINTF("SetPixelFormat()");
-    if (xvi == 0)
+    if (!PIXEL_FORMAT_PRESET)
         return MGLPresetPixelFormat();
     return 1;
 }
@@ -481,7 +520,7 @@ int MGLSetPixelFormat(int fmt, const void *p)
 int MGLDescribePixelFormat(int fmt, unsigned int sz, void *p)
 {
     //DPRINTF("DescribePixelFormat()");
-    if (xvi == 0)
+    if (!PIXEL_FORMAT_PRESET)
         MGLPresetPixelFormat();
     memcpy(p, &pfd, sizeof(PIXELFORMATDESCRIPTOR));
     ((PIXELFORMATDESCRIPTOR *)p)->cDepthBits = cDepthBits;
@@ -500,6 +539,8 @@ int NumPbuffer(void)
 
 int DrawableContext(void)
 {
+    if (MGLHeadless())
+        return MGLEglDrawableContext();
     return (ctx[0] == glXGetCurrentContext());
 }
 
@@ -592,7 +633,7 @@ void MGLFuncHandler(const char *name)
     }
     FUNCP_HANDLER("wglUseFontBitmapsA") {
         uint32_t ret = 0;
-        XFontStruct *fi = XLoadQueryFont(dpy, "fixed");
+        XFontStruct *fi = (dpy)? XLoadQueryFont(dpy, "fixed"):0;
         if (fi) {
             int minchar = fi->min_char_or_byte2;
             int maxchar = fi->max_char_or_byte2;
@@ -633,6 +674,8 @@ void MGLFuncHandler(const char *name)
             val = xglFuncs.GetSwapIntervalEXT();
         else if (find_xstr(xstr, "GLX_EXT_swap_control"))
             glXQueryDrawable(dpy, win, GLX_SWAP_INTERVAL_EXT, (unsigned int *)&val);
+        else if (MGLHeadless())
+            val = 0;
         if (val != -1) {
             argsp[0] = val;
             DPRINTF("wglGetSwapIntervalEXT() ret %-24u", argsp[0]);
@@ -659,6 +702,10 @@ void MGLFuncHandler(const char *name)
         }
     }
     FUNCP_HANDLER("wglCreateContextAttribsARB") {
+        if (MGLHeadless()) {
+            MGLEglContextAttribs(argsp);
+            return;
+        }
         strncpy(fname, "glXCreateContextAttribsARB", sizeof(fname)-1);
         GLXContext (*fp)(Display *, GLXFBConfig, GLXContext, Bool, const int *) =
             (GLXContext (*)(Display *, GLXFBConfig, GLXContext, Bool, const int *)) MesaGLGetProc(fname);
@@ -733,7 +780,11 @@ void MGLFuncHandler(const char *name)
     }
     FUNCP_HANDLER("wglBindTexImageARB") {
         uint32_t i = argsp[0] & (MAX_PBUFFER - 1);
-        if (PbufferGLBinding(hPbuffer[i].target) && PbufferGLAttrib(hPbuffer[i].format)) {
+        if (MGLHeadless() && PbufferGLBinding(hPbuffer[i].target) && PbufferGLAttrib(hPbuffer[i].format))
+            MGLEglPbufferCopyTex(i, PbufferGLBinding(hPbuffer[i].target),
+                PbufferGLAttrib(hPbuffer[i].target), hPbuffer[i].level,
+                PbufferGLAttrib(hPbuffer[i].format), hPbuffer[i].width, hPbuffer[i].height);
+        else if (PbufferGLBinding(hPbuffer[i].target) && PbufferGLAttrib(hPbuffer[i].format)) {
             int prev_binded_texture = 0;
             GLXContext prev_context = glXGetCurrentContext();
             GLXDrawable prev_drawable = glXGetCurrentDrawable();
@@ -765,6 +816,11 @@ void MGLFuncHandler(const char *name)
         hPbuffer[i].target = LookupAttribArray(pattr, WGL_TEXTURE_TARGET_ARB);
         hPbuffer[i].format = LookupAttribArray(pattr, WGL_TEXTURE_FORMAT_ARB);
         hPbuffer[i].level = LookupAttribArray(pattr, WGL_MIPMAP_LEVEL_ARB);
+        if (MGLHeadless()) {
+            argsp[0] = MGLEglPbufferCreate(i, hPbuffer[i].width, hPbuffer[i].height);
+            argsp[1] = i;
+            return;
+        }
         const int ia[] = {
             GLX_X_RENDERABLE    , True,
             GLX_DRAWABLE_TYPE   , GLX_PBUFFER_BIT,
@@ -791,8 +847,12 @@ void MGLFuncHandler(const char *name)
     FUNCP_HANDLER("wglDestroyPbufferARB") {
         uint32_t i;
         i = argsp[0] & (MAX_PBUFFER - 1);
-        glXDestroyContext(dpy, PBRC[i]);
-        glXDestroyPbuffer(dpy, PBDC[i]);
+        if (MGLHeadless())
+            MGLEglPbufferDestroy(i);
+        else {
+            glXDestroyContext(dpy, PBRC[i]);
+            glXDestroyPbuffer(dpy, PBDC[i]);
+        }
         PBRC[i] = 0; PBDC[i] = 0;
         argsp[0] = 1;
         memset(&hPbuffer[i], 0, sizeof(HPBUFFERARB));
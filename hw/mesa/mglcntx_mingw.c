@@ -38,13 +38,10 @@ int MGLUpdateGuestBufo(mapbufo_t *bufo, int add)
 {
     int ret = GetBufOAccelEN()? whpx_enabled():0;
 
-    if (ret && bufo) {
-        bufo->lvl = (add)? MapBufObjGpa(bufo):0;
-        whpx_update_guest_pa_range(MBUFO_BASE | (bufo->gpa & ((MBUFO_SIZE - 1) - (qemu_real_host_page_size() - 1))),
-            bufo->mapsz + (bufo->hva & (qemu_real_host_page_size() - 1)),
-            (void *)(bufo->hva & qemu_real_host_page_mask()),
-            (bufo->acc & GL_MAP_WRITE_BIT)? 0:1, add);
-    }
+    if (ret && bufo)
+        ret = UpdateBufObjSlot(bufo, add, (GetBufOAccelEN() > 1), whpx_update_guest_pa_range);
+    else if (ret && (add < 0))
+        PurgeBufObjSlot(whpx_update_guest_pa_range);
 
     return ret;
 }
@@ -742,7 +739,7 @@ void MGLActivateHandler(const int i, const int d)
         DPRINTF_COND(GLFuncTrace(), "wm_activate %-32d", i);
         if (i) {
             deactivateGuiRefSched();
-            mesa_renderer_stat(i);
+            MGLRendererStat(i);
         }
         else
             deactivateSched(d);
@@ -771,7 +768,7 @@ static QEMUTimer *ts;
 static void deactivateOnce(void)
 {
     MGLMouseWarp(0);
-    mesa_renderer_stat(0);
+    MGLRendererStat(0);
 }
 static void deactivateOneshot(void *opaque)
 {
@@ -873,7 +870,7 @@ static void profile_stat(void)
     if (p->last == 0) {
 	p->fcount = 0;
 	p->ftime = 0;
-	p->last = (mesa_gui_fullscreen(0))? 0:get_clock();
+	p->last = (MGLGuiFullscreen(0))? 0:get_clock();
 	return;
     }
 
@@ -58,13 +58,10 @@ int MGLUpdateGuestBufo(mapbufo_t *bufo, int add)
 {
     int ret = GetBufOAccelEN()? kvm_enabled():0;
 
-    if (ret && bufo) {
-        bufo->lvl = (add)? MapBufObjGpa(bufo):0;
-        kvm_update_guest_pa_range(MBUFO_BASE | (bufo->gpa & ((MBUFO_SIZE - 1) - (qemu_real_host_page_size() - 1))),
-            bufo->mapsz + (bufo->hva & (qemu_real_host_page_size() - 1)),
-            (void *)(bufo->hva & qemu_real_host_page_mask()),
-            (bufo->acc & GL_MAP_WRITE_BIT)? 0:1, add);
-    }
+    if (ret && bufo)
+        ret = UpdateBufObjSlot(bufo, add, (GetBufOAccelEN() > 1), kvm_update_guest_pa_range);
+    else if (ret && (add < 0))
+        PurgeBufObjSlot(kvm_update_guest_pa_range);
 
     return ret;
 }
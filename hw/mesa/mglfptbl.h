@@ -1,6 +1,7 @@
 struct tblFuncs {
     const char *sym;
     int impl;
+    int nargs;
     void *ptr;
 };
 
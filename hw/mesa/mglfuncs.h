@@ -11,6 +11,10 @@ typedef struct {
     int type;
     int stride;
     void *ptr;
+    uint64_t hash;
+    uintptr_t hdst;
+    int hlen;
+    uint32_t hgen;
 } vtxarry_t;
 
 #define PAGE_SIZE       0x1000
@@ -0,0 +1,571 @@
+/*
+ * QEMU MESA GL Pass-Through
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "qemu/osdep.h"
+
+#include "mesagl_impl.h"
+
+#define DEBUG_MGLIMM
+
+#ifdef DEBUG_MGLIMM
+#define DPRINTF(fmt, ...) \
+    do { fprintf(stderr, "mgl_trace: " fmt "\n" , ## __VA_ARGS__); } while(0)
+#else
+#define DPRINTF(fmt, ...)
+#endif
+
+/*
+ * Immediate mode accumulator. Vertices between glBegin and glEnd are
+ * collected into a packed stream together with the current color,
+ * texcoord and normal, then drawn with a single glDrawArrays from
+ * client arrays. Consecutive blocks of the same independent primitive
+ * are merged until any other call arrives or the doorbell that carries
+ * them has been processed.
+ * Inside glNewList the same draw is compiled into the list, client
+ * arrays are dereferenced at compile time so the list keeps the vertex
+ * data in driver storage and replays it as one draw per merged run.
+ * Whatever cannot be expressed as arrays (an attribute that first
+ * shows up after a vertex, glMaterial, glArrayElement, ...) replays
+ * what was collected as plain immediate mode and passes the rest of
+ * the block through untouched.
+ */
+#ifndef GL_CLIENT_VERTEX_ARRAY_BIT
+#define GL_CLIENT_VERTEX_ARRAY_BIT  0x00000002
+#endif
+#ifndef GL_CLIENT_ACTIVE_TEXTURE
+#define GL_CLIENT_ACTIVE_TEXTURE    0x84E1
+#endif
+#ifndef GL_POLYGON
+#define GL_POLYGON                  0x0009
+#endif
+
+#define IMM_MAX_VERT    16384
+
+enum {
+    IMM_IDLE,
+    IMM_OPEN,
+    IMM_PENDING,
+    IMM_PASS,
+};
+
+#define IMM_COLOR       0x01
+#define IMM_TEXCOORD    0x02
+#define IMM_NORMAL      0x04
+
+typedef struct {
+    float pos[4];
+    float col[4];
+    float tex[4];
+    float nrm[3];
+} IMMVERT;
+
+static struct {
+    IMMVERT *vert;
+    IMMVERT cur;
+    int nvert, base;
+    uint32_t mode;
+    int mask;
+    int state;
+    int compile;
+    uint32_t blocks, draws, fallback, listDraws;
+} imm;
+
+/* Client arrays enabled on the host, resynced after anything opaque */
+static const uint32_t immCaps[] = {
+    GL_VERTEX_ARRAY, GL_NORMAL_ARRAY, GL_COLOR_ARRAY, GL_INDEX_ARRAY,
+    GL_EDGE_FLAG_ARRAY, GL_SECONDARY_COLOR_ARRAY, GL_FOG_COORD_ARRAY,
+};
+
+static struct {
+    int known;
+    int vao;
+    int client;
+    uint32_t caps;
+    uint32_t texunit;
+    uint32_t attrib;
+} immArr;
+
+static int ImmCapIndex(const uint32_t cap)
+{
+    for (int i = 0; i < ARRAY_SIZE(immCaps); i++) {
+        if (immCaps[i] == cap)
+            return i;
+    }
+    return -1;
+}
+
+static void ImmArraySync(void)
+{
+    MESA_PFN(PFNGLBINDVERTEXARRAYPROC,      glBindVertexArray);
+    MESA_PFN(PFNGLCLIENTACTIVETEXTUREPROC,  glClientActiveTexture);
+    MESA_PFN(PFNGLGETINTEGERVPROC,          glGetIntegerv);
+    MESA_PFN(PFNGLGETVERTEXATTRIBIVPROC,    glGetVertexAttribiv);
+    MESA_PFN(PFNGLISENABLEDPROC,            glIsEnabled);
+    int client = GL_TEXTURE0, ntex = 1, nattr = 0;
+
+    memset(&immArr, 0, sizeof(immArr));
+    if (p_glBindVertexArray)
+        PFN_CALL(glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &immArr.vao));
+    for (int i = 0; i < ARRAY_SIZE(immCaps); i++)
+        immArr.caps |= (PFN_CALL(glIsEnabled(immCaps[i])))? (1U << i):0;
+    if (p_glClientActiveTexture) {
+        PFN_CALL(glGetIntegerv(GL_CLIENT_ACTIVE_TEXTURE, &client));
+        PFN_CALL(glGetIntegerv(GL_MAX_TEXTURE_COORDS, &ntex));
+    }
+    for (int i = 0; i < MIN(ntex, 32); i++) {
+        if (p_glClientActiveTexture)
+            PFN_CALL(glClientActiveTexture(GL_TEXTURE0 + i));
+        immArr.texunit |= (PFN_CALL(glIsEnabled(GL_TEXTURE_COORD_ARRAY)))? (1U << i):0;
+    }
+    if (p_glClientActiveTexture)
+        PFN_CALL(glClientActiveTexture(client));
+    if (p_glGetVertexAttribiv)
+        PFN_CALL(glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nattr));
+    for (int i = 0; i < MIN(nattr, 32); i++) {
+        int enabled = 0;
+        PFN_CALL(glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled));
+        immArr.attrib |= (enabled)? (1U << i):0;
+    }
+    immArr.client = client - GL_TEXTURE0;
+    immArr.known = 1;
+}
+
+static void ImmArrayTrack(const int FEnum, const uint32_t *arg)
+{
+    int idx;
+
+    switch (FEnum) {
+        case FEnum_glEnableClientState:
+        case FEnum_glDisableClientState:
+            if (arg[0] == GL_TEXTURE_COORD_ARRAY) {
+                uint32_t bit = (immArr.client < 32)? (1U << immArr.client):0;
+                immArr.texunit = (FEnum == FEnum_glEnableClientState)?
+                    (immArr.texunit | bit):(immArr.texunit & ~bit);
+                break;
+            }
+            idx = ImmCapIndex(arg[0]);
+            if (idx >= 0)
+                immArr.caps = (FEnum == FEnum_glEnableClientState)?
+                    (immArr.caps | (1U << idx)):(immArr.caps & ~(1U << idx));
+            break;
+        case FEnum_glClientActiveTexture:
+        case FEnum_glClientActiveTextureARB:
+            immArr.client = arg[0] - GL_TEXTURE0;
+            break;
+        case FEnum_glEnableVertexAttribArray:
+        case FEnum_glEnableVertexAttribArrayARB:
+            immArr.attrib |= (arg[0] < 32)? (1U << arg[0]):0;
+            break;
+        case FEnum_glDisableVertexAttribArray:
+        case FEnum_glDisableVertexAttribArrayARB:
+            immArr.attrib &= (arg[0] < 32)? ~(1U << arg[0]):~0U;
+            break;
+        case FEnum_glBindVertexArray:
+        case FEnum_glBindVertexArrayAPPLE:
+        case FEnum_glDeleteVertexArrays:
+        case FEnum_glDeleteVertexArraysAPPLE:
+        case FEnum_glEnableClientStateIndexedEXT:
+        case FEnum_glDisableClientStateIndexedEXT:
+        case FEnum_glEnableClientStateiEXT:
+        case FEnum_glDisableClientStateiEXT:
+        case FEnum_glEnableVertexArrayAttrib:
+        case FEnum_glDisableVertexArrayAttrib:
+        case FEnum_glEnableVertexArrayAttribEXT:
+        case FEnum_glDisableVertexArrayAttribEXT:
+        case FEnum_glEnableVertexArrayEXT:
+        case FEnum_glDisableVertexArrayEXT:
+        case FEnum_glInterleavedArrays:
+        case FEnum_glPopClientAttrib:
+            immArr.known = 0;
+            break;
+        case FEnum_glNewList:
+            imm.compile = 1;
+            break;
+        case FEnum_glEndList:
+            imm.compile = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+static int ImmPrimSize(const uint32_t mode)
+{
+    switch (mode) {
+        case GL_POINTS:     return 1;
+        case GL_LINES:      return 2;
+        case GL_TRIANGLES:  return 3;
+        case GL_QUADS:      return 4;
+        default:
+            return 0;
+    }
+}
+
+static void ImmCurrent(const IMMVERT *v)
+{
+    MESA_PFN(PFNGLCOLOR4FVPROC,     glColor4fv);
+    MESA_PFN(PFNGLNORMAL3FVPROC,    glNormal3fv);
+    MESA_PFN(PFNGLTEXCOORD4FVPROC,  glTexCoord4fv);
+
+    if (imm.mask & IMM_COLOR)
+        PFN_CALL(glColor4fv(v->col));
+    if (imm.mask & IMM_TEXCOORD)
+        PFN_CALL(glTexCoord4fv(v->tex));
+    if (imm.mask & IMM_NORMAL)
+        PFN_CALL(glNormal3fv(v->nrm));
+}
+
+static void ImmDraw(const int count)
+{
+    MESA_PFN(PFNGLBINDBUFFERPROC,               glBindBuffer);
+    MESA_PFN(PFNGLCLIENTACTIVETEXTUREPROC,      glClientActiveTexture);
+    MESA_PFN(PFNGLCOLORPOINTERPROC,             glColorPointer);
+    MESA_PFN(PFNGLDISABLECLIENTSTATEPROC,       glDisableClientState);
+    MESA_PFN(PFNGLDISABLEVERTEXATTRIBARRAYPROC, glDisableVertexAttribArray);
+    MESA_PFN(PFNGLDRAWARRAYSPROC,               glDrawArrays);
+    MESA_PFN(PFNGLENABLECLIENTSTATEPROC,        glEnableClientState);
+    MESA_PFN(PFNGLNORMALPOINTERPROC,            glNormalPointer);
+    MESA_PFN(PFNGLPOPCLIENTATTRIBPROC,          glPopClientAttrib);
+    MESA_PFN(PFNGLPUSHCLIENTATTRIBPROC,         glPushClientAttrib);
+    MESA_PFN(PFNGLTEXCOORDPOINTERPROC,          glTexCoordPointer);
+    MESA_PFN(PFNGLVERTEXPOINTERPROC,            glVertexPointer);
+    const int stride = sizeof(IMMVERT);
+
+    if (!count)
+        return;
+
+    PFN_CALL(glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT));
+    if (p_glBindBuffer)
+        PFN_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    for (int i = 0; i < ARRAY_SIZE(immCaps); i++) {
+        if (immArr.caps & (1U << i))
+            PFN_CALL(glDisableClientState(immCaps[i]));
+    }
+    for (int i = 0; i < 32; i++) {
+        if (immArr.texunit & (1U << i)) {
+            if (p_glClientActiveTexture)
+                PFN_CALL(glClientActiveTexture(GL_TEXTURE0 + i));
+            PFN_CALL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+        }
+        if (immArr.attrib & (1U << i))
+            PFN_CALL(glDisableVertexAttribArray(i));
+    }
+    PFN_CALL(glEnableClientState(GL_VERTEX_ARRAY));
+    PFN_CALL(glVertexPointer(4, GL_FLOAT, stride, imm.vert[0].pos));
+    if (imm.mask & IMM_COLOR) {
+        PFN_CALL(glEnableClientState(GL_COLOR_ARRAY));
+        PFN_CALL(glColorPointer(4, GL_FLOAT, stride, imm.vert[0].col));
+    }
+    if (imm.mask & IMM_TEXCOORD) {
+        if (p_glClientActiveTexture)
+            PFN_CALL(glClientActiveTexture(GL_TEXTURE0));
+        PFN_CALL(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
+        PFN_CALL(glTexCoordPointer(4, GL_FLOAT, stride, imm.vert[0].tex));
+    }
+    if (imm.mask & IMM_NORMAL) {
+        PFN_CALL(glEnableClientState(GL_NORMAL_ARRAY));
+        PFN_CALL(glNormalPointer(GL_FLOAT, stride, imm.vert[0].nrm));
+    }
+    PFN_CALL(glDrawArrays(imm.mode, 0, count));
+    PFN_CALL(glPopClientAttrib());
+    /* current values of the arrays just drawn are undefined now */
+    ImmCurrent(&imm.cur);
+    imm.draws++;
+    imm.listDraws += (imm.compile)? 1:0;
+}
+
+static void ImmFallback(void)
+{
+    MESA_PFN(PFNGLBEGINPROC,        glBegin);
+    MESA_PFN(PFNGLVERTEX4FVPROC,    glVertex4fv);
+
+    ImmDraw(imm.base);
+    PFN_CALL(glBegin(imm.mode));
+    for (int i = imm.base; i < imm.nvert; i++) {
+        ImmCurrent(&imm.vert[i]);
+        PFN_CALL(glVertex4fv(imm.vert[i].pos));
+    }
+    ImmCurrent(&imm.cur);
+    imm.nvert = 0;
+    imm.base = 0;
+    imm.state = IMM_PASS;
+    imm.fallback++;
+}
+
+static int ImmAttr(const int bit)
+{
+    if (imm.mask & bit)
+        return 1;
+    if (imm.nvert != imm.base)
+        return 0;
+    /* new attribute at the start of a merged block, draw what came before */
+    ImmDraw(imm.nvert);
+    imm.nvert = 0;
+    imm.base = 0;
+    imm.mask |= bit;
+    return 1;
+}
+
+static int ImmVertex(const float x, const float y, const float z, const float w)
+{
+    IMMVERT *v;
+
+    if (imm.nvert == IMM_MAX_VERT) {
+        if (!imm.base)
+            return 0;
+        ImmDraw(imm.base);
+        memmove(imm.vert, &imm.vert[imm.base], (imm.nvert - imm.base) * sizeof(IMMVERT));
+        imm.nvert -= imm.base;
+        imm.base = 0;
+    }
+    v = &imm.vert[imm.nvert++];
+    *v = imm.cur;
+    v->pos[0] = x; v->pos[1] = y; v->pos[2] = z; v->pos[3] = w;
+    return 1;
+}
+
+static void ImmSet(float *dst, const float a, const float b, const float c, const float d)
+{
+    dst[0] = a; dst[1] = b; dst[2] = c; dst[3] = d;
+}
+
+static float ImmArgF(const uint32_t *arg, const int i)
+{
+    float f;
+    memcpy(&f, &arg[i], sizeof(float));
+    return f;
+}
+
+static float ImmArgD(const uint32_t *arg, const int i)
+{
+    double d;
+    memcpy(&d, &arg[i << 1], sizeof(double));
+    return d;
+}
+
+static int ImmOpen(const int FEnum, const uint32_t *arg, const uintptr_t *parg)
+{
+    const float *fv = (const float *)parg[0];
+    const double *dv = (const double *)parg[0];
+    const uint8_t *ubv = (const uint8_t *)parg[0];
+    int prim;
+
+    switch (FEnum) {
+        case FEnum_glEnd:
+            prim = ImmPrimSize(imm.mode);
+            if (prim && !((imm.nvert - imm.base) % prim)) {
+                imm.state = IMM_PENDING;
+                return 1;
+            }
+            ImmDraw(imm.nvert);
+            imm.nvert = 0;
+            imm.base = 0;
+            imm.state = IMM_IDLE;
+            return 1;
+        case FEnum_glVertex2f:
+            return ImmVertex(ImmArgF(arg, 0), ImmArgF(arg, 1), 0, 1);
+        case FEnum_glVertex3f:
+            return ImmVertex(ImmArgF(arg, 0), ImmArgF(arg, 1), ImmArgF(arg, 2), 1);
+        case FEnum_glVertex4f:
+            return ImmVertex(ImmArgF(arg, 0), ImmArgF(arg, 1), ImmArgF(arg, 2), ImmArgF(arg, 3));
+        case FEnum_glVertex2fv:
+            return ImmVertex(fv[0], fv[1], 0, 1);
+        case FEnum_glVertex3fv:
+            return ImmVertex(fv[0], fv[1], fv[2], 1);
+        case FEnum_glVertex4fv:
+            return ImmVertex(fv[0], fv[1], fv[2], fv[3]);
+        case FEnum_glVertex2d:
+            return ImmVertex(ImmArgD(arg, 0), ImmArgD(arg, 1), 0, 1);
+        case FEnum_glVertex3d:
+            return ImmVertex(ImmArgD(arg, 0), ImmArgD(arg, 1), ImmArgD(arg, 2), 1);
+        case FEnum_glVertex2dv:
+            return ImmVertex(dv[0], dv[1], 0, 1);
+        case FEnum_glVertex3dv:
+            return ImmVertex(dv[0], dv[1], dv[2], 1);
+        case FEnum_glVertex2i:
+            return ImmVertex((int32_t)arg[0], (int32_t)arg[1], 0, 1);
+        case FEnum_glVertex3i:
+            return ImmVertex((int32_t)arg[0], (int32_t)arg[1], (int32_t)arg[2], 1);
+        case FEnum_glColor3f:
+        case FEnum_glColor4f:
+        case FEnum_glColor3fv:
+        case FEnum_glColor4fv:
+        case FEnum_glColor3ub:
+        case FEnum_glColor4ub:
+        case FEnum_glColor3ubv:
+        case FEnum_glColor4ubv:
+            if (!ImmAttr(IMM_COLOR))
+                return 0;
+            if (FEnum == FEnum_glColor3f)
+                ImmSet(imm.cur.col, ImmArgF(arg, 0), ImmArgF(arg, 1), ImmArgF(arg, 2), 1);
+            else if (FEnum == FEnum_glColor4f)
+                ImmSet(imm.cur.col, ImmArgF(arg, 0), ImmArgF(arg, 1), ImmArgF(arg, 2), ImmArgF(arg, 3));
+            else if (FEnum == FEnum_glColor3fv)
+                ImmSet(imm.cur.col, fv[0], fv[1], fv[2], 1);
+            else if (FEnum == FEnum_glColor4fv)
+                ImmSet(imm.cur.col, fv[0], fv[1], fv[2], fv[3]);
+            else if (FEnum == FEnum_glColor3ub)
+                ImmSet(imm.cur.col, (arg[0] & 0xFFU) / 255.f, (arg[1] & 0xFFU) / 255.f,
+                    (arg[2] & 0xFFU) / 255.f, 1);
+            else if (FEnum == FEnum_glColor4ub)
+                ImmSet(imm.cur.col, (arg[0] & 0xFFU) / 255.f, (arg[1] & 0xFFU) / 255.f,
+                    (arg[2] & 0xFFU) / 255.f, (arg[3] & 0xFFU) / 255.f);
+            else
+                ImmSet(imm.cur.col, ubv[0] / 255.f, ubv[1] / 255.f, ubv[2] / 255.f,
+                    (FEnum == FEnum_glColor4ubv)? (ubv[3] / 255.f):1);
+            return 1;
+        case FEnum_glTexCoord2f:
+        case FEnum_glTexCoord3f:
+        case FEnum_glTexCoord4f:
+        case FEnum_glTexCoord2fv:
+        case FEnum_glTexCoord3fv:
+        case FEnum_glTexCoord4fv:
+        case FEnum_glTexCoord2d:
+        case FEnum_glTexCoord3d:
+        case FEnum_glTexCoord4d:
+        case FEnum_glTexCoord2dv:
+        case FEnum_glTexCoord3dv:
+        case FEnum_glTexCoord4dv:
+            if (!ImmAttr(IMM_TEXCOORD))
+                return 0;
+            if (FEnum == FEnum_glTexCoord2f)
+                ImmSet(imm.cur.tex, ImmArgF(arg, 0), ImmArgF(arg, 1), 0, 1);
+            else if (FEnum == FEnum_glTexCoord3f)
+                ImmSet(imm.cur.tex, ImmArgF(arg, 0), ImmArgF(arg, 1), ImmArgF(arg, 2), 1);
+            else if (FEnum == FEnum_glTexCoord4f)
+                ImmSet(imm.cur.tex, ImmArgF(arg, 0), ImmArgF(arg, 1), ImmArgF(arg, 2), ImmArgF(arg, 3));
+            else if (FEnum == FEnum_glTexCoord2fv)
+                ImmSet(imm.cur.tex, fv[0], fv[1], 0, 1);
+            else if (FEnum == FEnum_glTexCoord3fv)
+                ImmSet(imm.cur.tex, fv[0], fv[1], fv[2], 1);
+            else if (FEnum == FEnum_glTexCoord4fv)
+                ImmSet(imm.cur.tex, fv[0], fv[1], fv[2], fv[3]);
+            else if (FEnum == FEnum_glTexCoord2d)
+                ImmSet(imm.cur.tex, ImmArgD(arg, 0), ImmArgD(arg, 1), 0, 1);
+            else if (FEnum == FEnum_glTexCoord3d)
+                ImmSet(imm.cur.tex, ImmArgD(arg, 0), ImmArgD(arg, 1), ImmArgD(arg, 2), 1);
+            else if (FEnum == FEnum_glTexCoord4d)
+                ImmSet(imm.cur.tex, ImmArgD(arg, 0), ImmArgD(arg, 1), ImmArgD(arg, 2), ImmArgD(arg, 3));
+            else if (FEnum == FEnum_glTexCoord2dv)
+                ImmSet(imm.cur.tex, dv[0], dv[1], 0, 1);
+            else if (FEnum == FEnum_glTexCoord3dv)
+                ImmSet(imm.cur.tex, dv[0], dv[1], dv[2], 1);
+            else
+                ImmSet(imm.cur.tex, dv[0], dv[1], dv[2], dv[3]);
+            return 1;
+        case FEnum_glNormal3f:
+        case FEnum_glNormal3fv:
+            if (!ImmAttr(IMM_NORMAL))
+                return 0;
+            if (FEnum == FEnum_glNormal3f) {
+                imm.cur.nrm[0] = ImmArgF(arg, 0);
+                imm.cur.nrm[1] = ImmArgF(arg, 1);
+                imm.cur.nrm[2] = ImmArgF(arg, 2);
+            }
+            else
+                memcpy(imm.cur.nrm, fv, sizeof(imm.cur.nrm));
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int ImmBegin(const uint32_t mode)
+{
+    if (imm.state == IMM_PENDING) {
+        if ((mode == imm.mode) && (imm.nvert < IMM_MAX_VERT)) {
+            imm.base = imm.nvert;
+            imm.state = IMM_OPEN;
+            imm.blocks++;
+            return 1;
+        }
+        MGLImmFlush();
+    }
+    if ((mode <= GL_POLYGON) && !immArr.known)
+        ImmArraySync();
+    if ((mode > GL_POLYGON) || immArr.vao) {
+        imm.state = IMM_PASS;
+        return 0;
+    }
+    if (!imm.vert)
+        imm.vert = g_new(IMMVERT, IMM_MAX_VERT);
+    imm.mode = mode;
+    imm.mask = 0;
+    imm.nvert = 0;
+    imm.base = 0;
+    imm.state = IMM_OPEN;
+    imm.blocks++;
+    return 1;
+}
+
+void MGLImmFlush(void)
+{
+    if (imm.state != IMM_PENDING)
+        return;
+    ImmDraw(imm.nvert);
+    imm.nvert = 0;
+    imm.base = 0;
+    imm.state = IMM_IDLE;
+}
+
+int MGLImmFunc(const int FEnum, const uint32_t *arg, const uintptr_t *parg)
+{
+    if (!GLImmBatch())
+        return 0;
+
+    switch (imm.state) {
+        case IMM_OPEN:
+            if (ImmOpen(FEnum, arg, parg))
+                return 1;
+            ImmFallback();
+            return 0;
+        case IMM_PASS:
+            imm.state = (FEnum == FEnum_glEnd)? IMM_IDLE:IMM_PASS;
+            return 0;
+        default:
+            break;
+    }
+    if (FEnum == FEnum_glBegin)
+        return ImmBegin(arg[0]);
+    MGLImmFlush();
+    ImmArrayTrack(FEnum, arg);
+    return 0;
+}
+
+void MGLImmReset(void)
+{
+    immArr.known = 0;
+}
+
+void MGLImmInit(void)
+{
+    if (imm.blocks)
+        DPRINTF("ImmBatch blocks %u draws %u fallback %u list %u", imm.blocks, imm.draws, imm.fallback, imm.listDraws);
+    imm.blocks = 0;
+    imm.listDraws = 0;
+    imm.draws = 0;
+    imm.fallback = 0;
+    imm.nvert = 0;
+    imm.base = 0;
+    imm.state = IMM_IDLE;
+    imm.compile = 0;
+    MGLImmReset();
+}
@@ -0,0 +1,30 @@
+/*
+ * QEMU MESA GL Pass-Through
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _MGL_IMM_H
+#define _MGL_IMM_H
+
+void MGLImmInit(void);
+void MGLImmReset(void);
+void MGLImmFlush(void);
+int MGLImmFunc(const int, const uint32_t *, const uintptr_t *);
+
+#endif //_MGL_IMM_H
@@ -19,106 +19,204 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/interval-tree.h"
 
 #include "mglfuncs.h"
 #include "mglmapbo.h"
 
 
+typedef struct {
+    uint64_t gpa;
+    uint64_t size;
+    uintptr_t hva;
+    int ro;
+    int live;
+} BUFOSLOT;
+
 typedef struct _bufobj {
     mapbufo_t bo;
-    struct _bufobj *next;
+    IntervalTreeNode itree;
+    int inwnd;
+    int wndmap;
+    BUFOSLOT slot;
 } MAPBO, * PMAPBO;
 
-static PMAPBO pbufo = NULL;
+static GHashTable *htbufo = NULL;
+static IntervalTreeRoot bufo_root;
+static uint64_t bufo_cursor;
+static uint32_t slot_hit, slot_miss;
 
-void InitBufObj(void)
+static void UnmapBufObjGpa(PMAPBO p)
 {
-    PMAPBO p = pbufo;
-    while (p) {
-        PMAPBO next = p->next;
-        g_free(p);
-        p = next;
+    if (p->inwnd) {
+        interval_tree_remove(&p->itree, &bufo_root);
+        p->inwnd = 0;
     }
-    pbufo = p;
+}
+
+static void DestroyBufObj(gpointer data)
+{
+    PMAPBO p = data;
+    UnmapBufObjGpa(p);
+    g_free(p);
+}
+
+void InitBufObj(void)
+{
+    if (htbufo)
+        g_hash_table_destroy(htbufo);
+    htbufo = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, DestroyBufObj);
+    memset(&bufo_root, 0, sizeof(IntervalTreeRoot));
+    bufo_cursor = 0;
 }
 
 mapbufo_t *LookupBufObj(const int idx)
 {
-    PMAPBO p = pbufo;
+    PMAPBO p;
 
-    while(p) {
-        if ((idx == p->bo.idx) || (p->next == NULL))
-            break;
-        p = p->next;
-    }
+    if (!htbufo)
+        InitBufObj();
 
+    p = g_hash_table_lookup(htbufo, GINT_TO_POINTER(idx));
     if (p == NULL) {
         p = g_new0(MAPBO, 1);
         p->bo.idx = idx;
-        pbufo = p;
-    }
-    else {
-        if (idx == p->bo.idx) { }
-        else {
-            p->next = g_new0(MAPBO, 1);
-            p = p->next;
-            p->bo.idx = idx;
-        }
+        g_hash_table_insert(htbufo, GINT_TO_POINTER(idx), p);
     }
     return &p->bo;
 }
 
+mapbufo_t *FindBufObj(const int idx)
+{
+    PMAPBO p = (htbufo)? g_hash_table_lookup(htbufo, GINT_TO_POINTER(idx)):NULL;
+    return (p)? &p->bo:NULL;
+}
+
 int FreeBufObj(const int idx)
 {
-    PMAPBO prev = pbufo, curr = pbufo;
-    int cnt = 0;
-    while (curr) {
-        if (idx == curr->bo.idx) {
-            if (pbufo == curr)
-                pbufo = curr->next;
-            else
-                prev->next = curr->next;
-            g_free(curr);
-            break;
+    PMAPBO p;
+
+    if (!htbufo)
+        return 0;
+    p = g_hash_table_lookup(htbufo, GINT_TO_POINTER(idx));
+    if (p && !p->slot.live)
+        g_hash_table_remove(htbufo, GINT_TO_POINTER(idx));
+    return g_hash_table_size(htbufo);
+}
+
+static int FitBufObjGpa(uint64_t *base, uint64_t size)
+{
+    uint64_t start[] = { *base, 0 },
+             limit[] = { MBUFO_SIZE, MIN((*base + size), MBUFO_SIZE) };
+
+    for (int i = 0; i < 2; i++) {
+        uint64_t addr = start[i];
+        while ((addr + size) <= limit[i]) {
+            IntervalTreeNode *n = interval_tree_iter_first(&bufo_root, addr, addr + size - 1);
+            if (n == NULL) {
+                *base = addr;
+                return 1;
+            }
+            addr = n->last + 1;
         }
-        prev = curr;
-        curr = curr->next;
     }
+    return 0;
+}
+
+int MapBufObjGpa(mapbufo_t *bufo)
+{
+    PMAPBO p = container_of(bufo, MAPBO, bo);
+    uint64_t pgoff = bufo->hva & (qemu_real_host_page_size() - 1),
+             size = ROUND_UP((bufo->mapsz + pgoff), qemu_real_host_page_size()),
+             base = bufo->hva & (MBUFO_SIZE - 1) & qemu_real_host_page_mask();
+
+    UnmapBufObjGpa(p);
 
-    curr = pbufo;
-    while (curr) {
-        cnt++;
-        curr = curr->next;
+    /* Identity placement when free, else next-fit from the last allocation */
+    if (((base + size) > MBUFO_SIZE) ||
+        interval_tree_iter_first(&bufo_root, base, base + size - 1)) {
+        base = bufo_cursor;
+        if (!FitBufObjGpa(&base, size)) {
+            bufo->gpa = 0;
+            return g_hash_table_size(htbufo);
+        }
     }
-    return cnt;
+    bufo->gpa = base | pgoff;
+    p->itree.start = base;
+    p->itree.last = base + size - 1;
+    interval_tree_insert(&p->itree, &bufo_root);
+    p->inwnd = 1;
+    bufo_cursor = (base + size) & (MBUFO_SIZE - 1);
+
+    return g_hash_table_size(htbufo);
 }
 
-int MapBufObjGpa(mapbufo_t *bufo)
+static void ReleaseBufObjSlot(PMAPBO p, bufo_slot_fn update_slot)
 {
-    PMAPBO curr = pbufo;
-    int ret = 0;
-
-    bufo->gpa = bufo->hva & (MBUFO_SIZE - 1);
-    if (bufo != &curr->bo) {
-        uintptr_t addr_lo = MBUFO_SIZE - 1, addr_hi = 0;
-        uint32_t bufo_sz = ALIGNBO(bufo->mapsz) + (uint32_t)(bufo->hva & (qemu_real_host_page_size() - 1));
-        while (bufo != &curr->bo) {
-            uint32_t curr_sz = curr->bo.mapsz + (uint32_t)(curr->bo.hva & (qemu_real_host_page_size() - 1));
-            addr_lo = ((curr->bo.gpa & qemu_real_host_page_mask()) < addr_lo)?
-                (curr->bo.gpa & qemu_real_host_page_mask()):addr_lo;
-            addr_hi = (((curr->bo.gpa + curr_sz) & qemu_real_host_page_mask()) > addr_hi)?
-                ((curr->bo.gpa + curr_sz) & qemu_real_host_page_mask()):addr_hi;
-            curr = curr->next;
-            ret++;
+    if (p->slot.live) {
+        update_slot(MBUFO_BASE | p->slot.gpa, p->slot.size, (void *)p->slot.hva, p->slot.ro, 0);
+        p->slot.live = 0;
+    }
+    UnmapBufObjGpa(p);
+}
+
+int UpdateBufObjSlot(mapbufo_t *bufo, int add, int sticky, bufo_slot_fn update_slot)
+{
+    PMAPBO p = container_of(bufo, MAPBO, bo);
+    uintptr_t hva = bufo->hva & qemu_real_host_page_mask();
+    uint64_t pgoff = bufo->hva & (qemu_real_host_page_size() - 1),
+             size = bufo->mapsz + pgoff;
+    int ro = (bufo->acc & GL_MAP_WRITE_BIT)? 0:1, ret = 1;
+
+    if (add > 0) {
+        /* Sticky slot still covers this mapping, no memslot update */
+        if (p->slot.live && (p->slot.hva == hva) && (p->slot.size >= size) && (!p->slot.ro || ro)) {
+            bufo->gpa = p->slot.gpa | pgoff;
+            bufo->lvl = g_hash_table_size(htbufo);
+            slot_hit++;
+            p->wndmap = 1;
+            return 1;
         }
-        if (((bufo->gpa + bufo_sz) < addr_lo) || (bufo->gpa >= addr_hi))
-            return ret;
-        bufo->gpa = 0;
-        if (!bufo->gpa && (addr_lo > bufo_sz))
-            bufo->gpa = addr_lo - bufo_sz;
-        if (!bufo->gpa && ((addr_hi + bufo_sz) < MBUFO_SIZE))
-            bufo->gpa = addr_hi;
+        ReleaseBufObjSlot(p, update_slot);
+        bufo->lvl = MapBufObjGpa(bufo);
+        /* Window full, the caller falls back to the one-copy path */
+        if (!p->inwnd) {
+            bufo->gpa = 0;
+            p->wndmap = 0;
+            return 0;
+        }
+        p->slot.gpa = bufo->gpa & ((MBUFO_SIZE - 1) - (qemu_real_host_page_size() - 1));
+        p->slot.size = size;
+        p->slot.hva = hva;
+        p->slot.ro = ro;
+        update_slot(MBUFO_BASE | p->slot.gpa, p->slot.size, (void *)p->slot.hva, p->slot.ro, 1);
+        p->slot.live = 1;
+        p->wndmap = 1;
+        slot_miss++;
+        return 1;
+    }
+    if (add == 0) {
+        ret = p->wndmap;
+        p->wndmap = 0;
+    }
+    if (!sticky || (add < 0)) {
+        bufo->lvl = 0;
+        ReleaseBufObjSlot(p, update_slot);
     }
     return ret;
 }
 
+void PurgeBufObjSlot(bufo_slot_fn update_slot)
+{
+    GHashTableIter it;
+    gpointer v;
+
+    if (!htbufo)
+        return;
+    g_hash_table_iter_init(&it, htbufo);
+    while (g_hash_table_iter_next(&it, NULL, &v))
+        ReleaseBufObjSlot(v, update_slot);
+    if (slot_hit || slot_miss)
+        fprintf(stderr, " bufo memslot hit %u miss %u\n", slot_hit, slot_miss);
+    slot_hit = slot_miss = 0;
+}
@@ -33,10 +33,15 @@ typedef struct {
     uint32_t acc;
 } mapbufo_t;
 
+typedef void (*bufo_slot_fn)(uint64_t, uint64_t, void *, int, int);
+
 void InitBufObj(void);
 mapbufo_t *LookupBufObj(const int);
+mapbufo_t *FindBufObj(const int);
 int FreeBufObj(const int);
 int MapBufObjGpa(mapbufo_t *);
+int UpdateBufObjSlot(mapbufo_t *, int, int, bufo_slot_fn);
+void PurgeBufObjSlot(bufo_slot_fn);
 
 #endif //_MGL_MAPBO_H
 
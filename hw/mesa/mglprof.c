@@ -0,0 +1,273 @@
+/*
+ * QEMU MESA GL Pass-Through
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/atomic.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "qapi/type-helpers.h"
+#include "qapi/qapi-commands-machine-target.h"
+#include "qapi/qmp/qdict.h"
+#include "monitor/monitor.h"
+
+#include "mesagl_impl.h"
+
+/*
+ * Counters are only ever written by the thread running doMesaFunc(),
+ * which is either the vCPU thread or the render worker. The monitor
+ * reads them as they are and asks for a reset by raising prof_reset,
+ * which the writer honours at the start of the next doorbell.
+ */
+typedef struct {
+    uint64_t calls;
+    uint64_t ns;
+    uint64_t bytes;
+} PROFENTRY;
+
+/*
+ * Display lists called, open addressed on the list name. Lists are
+ * only counted here, the host driver keeps compiling and replaying
+ * them. A device-side compiler into VBOs would have to mirror every
+ * command legal in a list and the state it leaves behind, which is
+ * what the driver's own list compiler already does. What the device
+ * can cheaply help with is the vertex stream, glBegin/glEnd runs in a
+ * list reach the driver as merged array draws (see mglimm.c).
+ */
+#define PROF_LIST_MAX   4096
+#define PROF_LIST_PROBE 8
+
+typedef struct {
+    uint32_t list;
+    uint64_t calls;
+} LISTENTRY;
+
+static struct {
+    PROFENTRY func[FEnum_zzMGLFuncEnum_max];
+    LISTENTRY list[PROF_LIST_MAX];
+    uint64_t listOther;
+    uint64_t doorbells;
+    uint64_t batched;
+    uint64_t batchMax;
+    int64_t since;
+} prof;
+static int prof_reset = 1;
+static uint32_t listBase;
+
+int MGLProfileActive(void) { return GLFuncProfile(); }
+
+void MGLProfileFunc(const int FEnum, const int64_t ns)
+{
+    prof.func[FEnum].calls++;
+    prof.func[FEnum].ns += ns;
+}
+
+void MGLProfileFifo(const int FEnum, const uint32_t bytes)
+{
+    prof.func[FEnum].bytes += bytes;
+}
+
+void MGLProfileDoorbell(const int batch)
+{
+    if (qatomic_xchg(&prof_reset, 0)) {
+        memset(&prof, 0, sizeof(prof));
+        prof.since = get_clock();
+    }
+    prof.doorbells++;
+    prof.batched += batch;
+    prof.batchMax = (prof.batchMax < batch)? batch:prof.batchMax;
+}
+
+static void prof_list(const uint32_t list)
+{
+    uint32_t h = (list * 0x9E3779B1U) >> 20;
+
+    if (!list)
+        return;
+    for (int i = 0; i < PROF_LIST_PROBE; i++) {
+        LISTENTRY *e = &prof.list[(h + i) & (PROF_LIST_MAX - 1)];
+        if (e->list == list) {
+            e->calls++;
+            return;
+        }
+        if (!e->list) {
+            e->list = list;
+            e->calls = 1;
+            return;
+        }
+    }
+    prof.listOther++;
+}
+
+void MGLProfileList(const int FEnum, const uint32_t *arg, const uintptr_t *parg)
+{
+    const void *lists;
+
+    switch (FEnum) {
+        case FEnum_glListBase:
+            listBase = arg[0];
+            break;
+        case FEnum_glCallList:
+            prof_list(arg[0]);
+            break;
+        case FEnum_glCallLists:
+            lists = (const void *)parg[2];
+            for (int i = 0; lists && (i < (int)arg[0]); i++) {
+                uint32_t n;
+                switch (arg[1]) {
+                    case GL_BYTE:           n = ((const int8_t *)lists)[i]; break;
+                    case GL_UNSIGNED_BYTE:  n = ((const uint8_t *)lists)[i]; break;
+                    case GL_SHORT:          n = ((const int16_t *)lists)[i]; break;
+                    case GL_UNSIGNED_SHORT: n = ((const uint16_t *)lists)[i]; break;
+                    case GL_INT:
+                    case GL_UNSIGNED_INT:   n = ((const uint32_t *)lists)[i]; break;
+                    case GL_FLOAT:          n = ((const float *)lists)[i]; break;
+                    case GL_2_BYTES:
+                        n = (((const uint8_t *)lists)[2*i] << 8) | ((const uint8_t *)lists)[2*i+1];
+                        break;
+                    case GL_3_BYTES:
+                        n = (((const uint8_t *)lists)[3*i] << 16) |
+                            (((const uint8_t *)lists)[3*i+1] << 8) | ((const uint8_t *)lists)[3*i+2];
+                        break;
+                    case GL_4_BYTES:
+                        n = (((const uint8_t *)lists)[4*i] << 24) | (((const uint8_t *)lists)[4*i+1] << 16) |
+                            (((const uint8_t *)lists)[4*i+2] << 8) | ((const uint8_t *)lists)[4*i+3];
+                        break;
+                    default:
+                        return;
+                }
+                prof_list(listBase + n);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static gint list_cmp(gconstpointer a, gconstpointer b)
+{
+    const LISTENTRY *pa = &prof.list[*(const int *)a],
+          *pb = &prof.list[*(const int *)b];
+
+    if (pa->calls != pb->calls)
+        return (pa->calls < pb->calls)? 1:-1;
+    return (pa->list < pb->list)? -1:(pa->list > pb->list);
+}
+
+static gint prof_cmp(gconstpointer a, gconstpointer b)
+{
+    const PROFENTRY *pa = &prof.func[*(const int *)a],
+          *pb = &prof.func[*(const int *)b];
+
+    if (pa->ns != pb->ns)
+        return (pa->ns < pb->ns)? 1:-1;
+    if (pa->calls != pb->calls)
+        return (pa->calls < pb->calls)? 1:-1;
+    return 0;
+}
+
+static void prof_dump(GString *buf)
+{
+    g_autofree int *idx = g_new(int, FEnum_zzMGLFuncEnum_max);
+    uint64_t calls = 0, ns = 0, bytes = 0;
+    int n = 0;
+
+    for (int i = 0; i < FEnum_zzMGLFuncEnum_max; i++) {
+        if (prof.func[i].calls || prof.func[i].bytes) {
+            calls += prof.func[i].calls;
+            ns += prof.func[i].ns;
+            bytes += prof.func[i].bytes;
+            idx[n++] = i;
+        }
+    }
+    qsort(idx, n, sizeof(int), prof_cmp);
+
+    g_string_append_printf(buf, "MesaGL profile: %.3f s sampled\n",
+        (prof.since)? ((get_clock() - prof.since) / 1e9):0);
+    g_string_append_printf(buf, "  doorbells %" PRIu64 " batched %" PRIu64
+        " (%.2f/doorbell, max %" PRIu64 ")\n", prof.doorbells, prof.batched,
+        (prof.doorbells)? ((double)prof.batched / prof.doorbells):0, prof.batchMax);
+    g_string_append_printf(buf, "  calls %" PRIu64 " host %.3f ms fifo %" PRIu64 " KB\n",
+        calls, ns / 1e6, bytes >> 10);
+    if (prof.func[FEnum_glCallList].calls || prof.func[FEnum_glCallLists].calls) {
+        g_autofree int *lidx = g_new(int, PROF_LIST_MAX);
+        uint64_t lcalls = prof.listOther;
+        int ln = 0;
+
+        for (int i = 0; i < PROF_LIST_MAX; i++) {
+            if (prof.list[i].calls) {
+                lcalls += prof.list[i].calls;
+                lidx[ln++] = i;
+            }
+        }
+        qsort(lidx, ln, sizeof(int), list_cmp);
+        g_string_append_printf(buf, "  display lists %d called %" PRIu64 " untracked %" PRIu64 "\n",
+            ln, lcalls, prof.listOther);
+        for (int i = 0; i < MIN(ln, 16); i++)
+            g_string_append_printf(buf, "    list %-8u %12" PRIu64 "\n",
+                prof.list[lidx[i]].list, prof.list[lidx[i]].calls);
+    }
+    g_string_append_printf(buf, "%12s %12s %9s %6s %10s  %s\n",
+        "calls", "host-us", "avg-ns", "host%", "fifo-KB", "function");
+    for (int i = 0; i < n; i++) {
+        const PROFENTRY *p = &prof.func[idx[i]];
+        const char *sym = GLFEnumFuncSym(idx[i]);
+        int len = strcspn(sym, "@");
+        g_string_append_printf(buf, "%12" PRIu64 " %12" PRIu64 " %9" PRIu64 " %6.2f %10" PRIu64 "  %.*s\n",
+            p->calls, p->ns / 1000, (p->calls)? (p->ns / p->calls):0,
+            (ns)? ((100.0 * p->ns) / ns):0, p->bytes >> 10, len - 1, sym + 1);
+    }
+}
+
+HumanReadableText *qmp_x_query_mesapt_profile(bool has_reset, bool reset,
+                                              Error **errp)
+{
+    g_autoptr(GString) buf = g_string_new("");
+
+    if (!MGLProfileActive()) {
+        error_setg(errp, "MesaGL profiler is disabled, set FuncProfile,1 in mesagl.cfg");
+        return NULL;
+    }
+    if (qatomic_read(&prof_reset))
+        g_string_append_printf(buf, "MesaGL profile: reset pending\n");
+    else
+        prof_dump(buf);
+    if (has_reset && reset)
+        qatomic_set(&prof_reset, 1);
+
+    return human_readable_text_from_str(buf);
+}
+
+static void hmp_info_mesapt_profile(Monitor *mon, const QDict *qdict)
+{
+    Error *err = NULL;
+    g_autoptr(HumanReadableText) info =
+        qmp_x_query_mesapt_profile(true, qdict_get_try_bool(qdict, "reset", false), &err);
+
+    if (err) {
+        error_report_err(err);
+        return;
+    }
+    monitor_puts(mon, info->human_readable_text);
+}
+
+void MGLProfileRegister(void)
+{
+    monitor_register_hmp("mesapt-profile", true, hmp_info_mesapt_profile);
+}
@@ -0,0 +1,31 @@
+/*
+ * QEMU MESA GL Pass-Through
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MGL_PROFILE_H
+#define _MGL_PROFILE_H
+
+int MGLProfileActive(void);
+void MGLProfileFunc(const int, const int64_t);
+void MGLProfileFifo(const int, const uint32_t);
+void MGLProfileDoorbell(const int);
+void MGLProfileList(const int, const uint32_t *, const uintptr_t *);
+void MGLProfileRegister(void);
+
+#endif //_MGL_PROFILE_H
@@ -0,0 +1,422 @@
+/*
+ * QEMU MESA GL Pass-Through
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/atomic.h"
+#include "qemu/thread.h"
+
+#include "mesagl_impl.h"
+
+#define DEBUG_MGLSHCACHE
+
+#ifdef DEBUG_MGLSHCACHE
+#define DPRINTF(fmt, ...) \
+    do { fprintf(stderr, "mgl_trace: " fmt "\n" , ## __VA_ARGS__); } while(0)
+#else
+#define DPRINTF(fmt, ...)
+#endif
+
+/*
+ * Program binary cache. A program is keyed by the host driver strings,
+ * the type and source digest of every attached shader and the pre-link
+ * state recorded against it (attribute/fragment data bindings, transform
+ * feedback varyings, program parameters). Linked programs are written
+ * out with glGetProgramBinary() and restored with glProgramBinary() on
+ * the next link of the same key, falling back to a real link whenever
+ * the driver rejects the binary.
+ */
+#define SHCACHE_MAGIC       "MGLPBIN1"
+#define SHCACHE_SUFFIX      ".bin"
+#define SHCACHE_MAX_STAGE   8
+#define SHCACHE_WARM_MAX    (64 << 20)
+
+typedef struct {
+    char magic[8];
+    uint32_t format;
+    uint32_t length;
+} SHCACHEHDR;
+
+static struct {
+    GHashTable *shader;     /* name -> source digest */
+    GHashTable *state;      /* program -> GString of link state */
+    GHashTable *warm;       /* key -> GBytes, filled by the prewarm worker */
+    QemuMutex lock;
+    QemuThread worker;
+    char *dir;
+    char *driver;
+    size_t szWarm;
+    int init, nformats, running, quit;
+    uint32_t hit, miss, store, reject;
+} shc;
+
+static int shc_valid(const void *data, const size_t len)
+{
+    const SHCACHEHDR *hdr = data;
+
+    return ((len > sizeof(SHCACHEHDR)) &&
+        !memcmp(hdr->magic, SHCACHE_MAGIC, sizeof(hdr->magic)) &&
+        (hdr->length == (len - sizeof(SHCACHEHDR))))? 1:0;
+}
+
+static char *shc_path(const char *key)
+{
+    g_autofree char *name = g_strconcat(key, SHCACHE_SUFFIX, NULL);
+    return g_build_filename(shc.dir, name, NULL);
+}
+
+static int shc_warm_insert(const char *key, GBytes *blob)
+{
+    int ret = 0;
+
+    qemu_mutex_lock(&shc.lock);
+    if ((shc.szWarm + g_bytes_get_size(blob)) <= SHCACHE_WARM_MAX) {
+        if (!g_hash_table_contains(shc.warm, key)) {
+            shc.szWarm += g_bytes_get_size(blob);
+            g_hash_table_insert(shc.warm, g_strdup(key), g_bytes_ref(blob));
+        }
+        ret = 1;
+    }
+    qemu_mutex_unlock(&shc.lock);
+    return ret;
+}
+
+static void *shc_prewarm(void *opaque)
+{
+    GDir *dir = g_dir_open(shc.dir, 0, NULL);
+    const char *name;
+    int cnt = 0;
+
+    while (dir && !qatomic_read(&shc.quit) && (name = g_dir_read_name(dir))) {
+        g_autofree char *path = 0;
+        g_autofree char *key = 0;
+        g_autoptr(GBytes) blob = 0;
+        char *data;
+        gsize len;
+
+        if (!g_str_has_suffix(name, SHCACHE_SUFFIX))
+            continue;
+        path = g_build_filename(shc.dir, name, NULL);
+        if (!g_file_get_contents(path, &data, &len, NULL))
+            continue;
+        blob = g_bytes_new_take(data, len);
+        if (!shc_valid(data, len))
+            continue;
+        key = g_strndup(name, strlen(name) - strlen(SHCACHE_SUFFIX));
+        if (!shc_warm_insert(key, blob))
+            break;
+        cnt++;
+    }
+    if (dir)
+        g_dir_close(dir);
+    DPRINTF("ShaderCache prewarm %d programs %zuKB", cnt, shc.szWarm >> 10);
+    return 0;
+}
+
+static GBytes *shc_lookup(const char *key)
+{
+    g_autofree char *path = 0;
+    GBytes *blob;
+    char *data;
+    gsize len;
+
+    qemu_mutex_lock(&shc.lock);
+    blob = g_hash_table_lookup(shc.warm, key);
+    blob = (blob)? g_bytes_ref(blob):0;
+    qemu_mutex_unlock(&shc.lock);
+    if (blob)
+        return blob;
+
+    path = shc_path(key);
+    if (!g_file_get_contents(path, &data, &len, NULL))
+        return 0;
+    if (!shc_valid(data, len)) {
+        g_free(data);
+        return 0;
+    }
+    return g_bytes_new_take(data, len);
+}
+
+static void shc_evict(const char *key)
+{
+    g_autofree char *path = shc_path(key);
+    GBytes *blob;
+
+    qemu_mutex_lock(&shc.lock);
+    blob = g_hash_table_lookup(shc.warm, key);
+    if (blob) {
+        shc.szWarm -= g_bytes_get_size(blob);
+        g_hash_table_remove(shc.warm, key);
+    }
+    qemu_mutex_unlock(&shc.lock);
+    unlink(path);
+}
+
+static int shc_usable(void)
+{
+    MESA_PFN(PFNGLGETINTEGERVPROC, glGetIntegerv);
+    MESA_PFN(PFNGLGETSTRINGPROC, glGetString);
+
+    if (!shc.dir || (shc.nformats < 0))
+        return 0;
+    if (shc.nformats == 0) {
+        int n = 0;
+        if (GLFEnumFuncPtr(FEnum_glProgramBinary) && GLFEnumFuncPtr(FEnum_glGetProgramBinary))
+            PFN_CALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n));
+        shc.nformats = (n > 0)? n:-1;
+        g_free(shc.driver);
+        shc.driver = g_strdup_printf("%s\n%s\n%s\n", PFN_CALL(glGetString(GL_VENDOR)),
+            PFN_CALL(glGetString(GL_RENDERER)), PFN_CALL(glGetString(GL_VERSION)));
+        DPRINTF("ShaderCache %s, %d binary formats", (shc.nformats > 0)? "enabled":"unsupported", n);
+    }
+    return (shc.nformats > 0)? 1:0;
+}
+
+static gint shc_stage_cmp(gconstpointer a, gconstpointer b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static char *shc_key(const uint32_t prog)
+{
+    MESA_PFN(PFNGLGETATTACHEDSHADERSPROC, glGetAttachedShaders);
+    MESA_PFN(PFNGLGETSHADERIVPROC, glGetShaderiv);
+    g_autoptr(GChecksum) cs = 0;
+    g_autoptr(GPtrArray) stage = 0;
+    GString *state;
+    uint32_t sh[SHCACHE_MAX_STAGE];
+    int n = 0;
+
+    if (!shc_usable())
+        return 0;
+    PFN_CALL(glGetAttachedShaders(prog, SHCACHE_MAX_STAGE, &n, sh));
+    if (!n)
+        return 0;
+    stage = g_ptr_array_new_with_free_func(g_free);
+    for (int i = 0; i < n; i++) {
+        const char *digest = g_hash_table_lookup(shc.shader, GUINT_TO_POINTER(sh[i]));
+        int type = 0;
+        if (!digest)
+            return 0;
+        PFN_CALL(glGetShaderiv(sh[i], GL_SHADER_TYPE, &type));
+        g_ptr_array_add(stage, g_strdup_printf("%04x:%s\n", type, digest));
+    }
+    /* attach order does not change the linked program */
+    g_ptr_array_sort(stage, shc_stage_cmp);
+    cs = g_checksum_new(G_CHECKSUM_SHA256);
+    g_checksum_update(cs, (const guchar *)shc.driver, -1);
+    for (int i = 0; i < stage->len; i++)
+        g_checksum_update(cs, g_ptr_array_index(stage, i), -1);
+    state = g_hash_table_lookup(shc.state, GUINT_TO_POINTER(prog));
+    if (state)
+        g_checksum_update(cs, (const guchar *)state->str, state->len);
+
+    return g_strdup(g_checksum_get_string(cs));
+}
+
+static int shc_restore(const uint32_t prog, const char *key)
+{
+    MESA_PFN(PFNGLGETPROGRAMIVPROC, glGetProgramiv);
+    MESA_PFN(PFNGLPROGRAMBINARYPROC, glProgramBinary);
+    g_autoptr(GBytes) blob = shc_lookup(key);
+    const SHCACHEHDR *hdr;
+    int status = 0;
+
+    if (!blob)
+        return 0;
+    hdr = g_bytes_get_data(blob, NULL);
+    PFN_CALL(glProgramBinary(prog, hdr->format, &hdr[1], hdr->length));
+    PFN_CALL(glGetProgramiv(prog, GL_LINK_STATUS, &status));
+    if (!status) {
+        shc.reject++;
+        shc_evict(key);
+    }
+    return status;
+}
+
+static void shc_store(const uint32_t prog, const char *key)
+{
+    MESA_PFN(PFNGLGETPROGRAMBINARYPROC, glGetProgramBinary);
+    MESA_PFN(PFNGLGETPROGRAMIVPROC, glGetProgramiv);
+    g_autofree char *path = 0;
+    g_autoptr(GBytes) blob = 0;
+    SHCACHEHDR *hdr;
+    uint32_t format;
+    int status = 0, length = 0;
+
+    PFN_CALL(glGetProgramiv(prog, GL_LINK_STATUS, &status));
+    if (status)
+        PFN_CALL(glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (!length)
+        return;
+    hdr = g_malloc(sizeof(SHCACHEHDR) + length);
+    PFN_CALL(glGetProgramBinary(prog, length, &length, &format, &hdr[1]));
+    memcpy(hdr->magic, SHCACHE_MAGIC, sizeof(hdr->magic));
+    hdr->format = format;
+    hdr->length = length;
+    blob = g_bytes_new_take(hdr, sizeof(SHCACHEHDR) + length);
+    path = shc_path(key);
+    if (g_file_set_contents(path, (const char *)hdr, sizeof(SHCACHEHDR) + length, NULL)) {
+        shc_warm_insert(key, blob);
+        shc.store++;
+    }
+}
+
+static void shc_source(const uint32_t shader, const int count, const char **str, const int *len)
+{
+    g_autoptr(GChecksum) cs = g_checksum_new(G_CHECKSUM_SHA256);
+
+    for (int i = 0; i < count; i++)
+        g_checksum_update(cs, (const guchar *)str[i], (len && (len[i] >= 0))? len[i]:-1);
+    g_hash_table_insert(shc.shader, GUINT_TO_POINTER(shader), g_strdup(g_checksum_get_string(cs)));
+}
+
+static void G_GNUC_PRINTF(2, 3) shc_state(const uint32_t prog, const char *fmt, ...)
+{
+    GString *state = g_hash_table_lookup(shc.state, GUINT_TO_POINTER(prog));
+    va_list ap;
+
+    if (!state) {
+        state = g_string_new("");
+        g_hash_table_insert(shc.state, GUINT_TO_POINTER(prog), state);
+    }
+    va_start(ap, fmt);
+    g_string_append_vprintf(state, fmt, ap);
+    va_end(ap);
+}
+
+static void shc_state_free(gpointer data)
+{
+    g_string_free(data, TRUE);
+}
+
+void MGLShaderCacheTrack(const int FEnum, const uint32_t *arg, const uintptr_t *parg, const uintptr_t ret)
+{
+    if (!shc.dir)
+        return;
+
+    switch (FEnum) {
+        case FEnum_glShaderSource:
+        case FEnum_glShaderSourceARB:
+            shc_source(arg[0], arg[1], (const char **)parg[2], (const int *)parg[3]);
+            break;
+        case FEnum_glCreateShader:
+        case FEnum_glCreateShaderObjectARB:
+        case FEnum_glCreateProgram:
+        case FEnum_glCreateProgramObjectARB:
+            g_hash_table_remove(shc.shader, GUINT_TO_POINTER((uint32_t)ret));
+            g_hash_table_remove(shc.state, GUINT_TO_POINTER((uint32_t)ret));
+            break;
+        case FEnum_glDeleteShader:
+        case FEnum_glDeleteProgram:
+        case FEnum_glDeleteObjectARB:
+            g_hash_table_remove(shc.shader, GUINT_TO_POINTER(arg[0]));
+            g_hash_table_remove(shc.state, GUINT_TO_POINTER(arg[0]));
+            break;
+        case FEnum_glBindAttribLocation:
+        case FEnum_glBindAttribLocationARB:
+            shc_state(arg[0], "A%u %s\n", arg[1], (const char *)parg[2]);
+            break;
+        case FEnum_glBindFragDataLocation:
+        case FEnum_glBindFragDataLocationEXT:
+            shc_state(arg[0], "F%u %s\n", arg[1], (const char *)parg[2]);
+            break;
+        case FEnum_glBindFragDataLocationIndexed:
+            shc_state(arg[0], "F%u.%u %s\n", arg[1], arg[2], (const char *)parg[3]);
+            break;
+        case FEnum_glTransformFeedbackVaryings:
+        case FEnum_glTransformFeedbackVaryingsEXT:
+            shc_state(arg[0], "X%04x", arg[3]);
+            for (int i = 0; i < arg[1]; i++)
+                shc_state(arg[0], " %s", ((const char **)parg[2])[i]);
+            shc_state(arg[0], "\n");
+            break;
+        case FEnum_glProgramParameteri:
+            shc_state(arg[0], "P%04x %u\n", arg[1], arg[2]);
+            break;
+        default:
+            break;
+    }
+}
+
+int MGLShaderCacheLink(const uint32_t prog)
+{
+    MESA_PFN(PFNGLLINKPROGRAMPROC, glLinkProgram);
+    MESA_PFN(PFNGLPROGRAMPARAMETERIPROC, glProgramParameteri);
+    g_autofree char *key = (shc.dir)? shc_key(prog):0;
+
+    if (!key)
+        return 0;
+    if (shc_restore(prog, key)) {
+        shc.hit++;
+        return 1;
+    }
+    shc.miss++;
+    PFN_CALL(glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    PFN_CALL(glLinkProgram(prog));
+    shc_store(prog, key);
+    return 1;
+}
+
+void MGLShaderCacheReset(void)
+{
+    shc.nformats = 0;
+    if (!GLShaderCache() || shc.dir)
+        return;
+
+    if (!shc.init) {
+        qemu_mutex_init(&shc.lock);
+        shc.init = 1;
+    }
+    shc.dir = g_build_filename(g_get_user_cache_dir(), "qemu-3dfx", "mesagl", NULL);
+    if (g_mkdir_with_parents(shc.dir, 0755)) {
+        DPRINTF("ShaderCache %s not writable", shc.dir);
+        g_free(shc.dir);
+        shc.dir = 0;
+        return;
+    }
+    shc.shader = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    shc.state = g_hash_table_new_full(NULL, NULL, NULL, shc_state_free);
+    shc.warm = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_bytes_unref);
+    shc.szWarm = 0;
+    shc.hit = shc.miss = shc.store = shc.reject = 0;
+    qatomic_set(&shc.quit, 0);
+    qemu_thread_create(&shc.worker, "mgl-shcache", shc_prewarm, 0, QEMU_THREAD_JOINABLE);
+    shc.running = 1;
+}
+
+void MGLShaderCacheFini(void)
+{
+    if (!shc.dir)
+        return;
+
+    if (shc.running) {
+        qatomic_set(&shc.quit, 1);
+        qemu_thread_join(&shc.worker);
+        shc.running = 0;
+    }
+    DPRINTF("ShaderCache hit %u miss %u store %u reject %u", shc.hit, shc.miss, shc.store, shc.reject);
+    g_hash_table_destroy(shc.shader);
+    g_hash_table_destroy(shc.state);
+    g_hash_table_destroy(shc.warm);
+    g_free(shc.driver);
+    g_free(shc.dir);
+    shc.driver = 0;
+    shc.dir = 0;
+}
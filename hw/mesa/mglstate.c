@@ -0,0 +1,331 @@
+/*
+ * QEMU MESA GL Pass-Through
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "qemu/osdep.h"
+
+#include "mesagl_impl.h"
+
+#define DEBUG_MGLSTATE
+
+#ifdef DEBUG_MGLSTATE
+#define DPRINTF(fmt, ...) \
+    do { fprintf(stderr, "mgl_trace: " fmt "\n" , ## __VA_ARGS__); } while(0)
+#else
+#define DPRINTF(fmt, ...)
+#endif
+
+/*
+ * Shadow of frequently queried enables and bindings, written from the
+ * setter calls seen by doMesaFunc() so that glGet*() and glIsEnabled()
+ * on them never reach the host driver. Entries start out unknown and
+ * only become valid through a setter. Anything that may change state
+ * behind our back (glCallList, glPopAttrib, context switches, indexed
+ * enables, deletes of bound objects) invalidates instead of guessing.
+ */
+#ifndef GL_MATRIX_MODE
+#define GL_MATRIX_MODE              0x0BA0
+#endif
+#ifndef GL_CLIENT_ACTIVE_TEXTURE
+#define GL_CLIENT_ACTIVE_TEXTURE    0x84E1
+#endif
+
+enum {
+    ST_DRAW_FRAMEBUFFER,
+    ST_READ_FRAMEBUFFER,
+    ST_CURRENT_PROGRAM,
+    ST_ACTIVE_TEXTURE,
+    ST_CLIENT_ACTIVE_TEXTURE,
+    ST_MATRIX_MODE,
+    ST_VERTEX_ARRAY,
+    ST_ARRAY_BUFFER,
+    ST_PACK_BUFFER,
+    ST_PACK_ALIGNMENT,
+    ST_PACK_ROW_LENGTH,
+    ST_PACK_SKIP_PIXELS,
+    ST_PACK_SKIP_ROWS,
+    ST_READ_BUFFER,
+    ST_CAPS,
+};
+
+static const uint32_t stCaps[] = {
+    GL_ALPHA_TEST, GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_DITHER,
+    GL_FOG, GL_LIGHTING, GL_LIGHT0, GL_LIGHT0 + 1, GL_LIGHT0 + 2,
+    GL_LIGHT0 + 3, GL_LIGHT0 + 4, GL_LIGHT0 + 5, GL_LIGHT0 + 6, GL_LIGHT7,
+    GL_NORMALIZE, GL_LINE_SMOOTH, GL_POINT_SMOOTH, GL_POLYGON_SMOOTH,
+    GL_POLYGON_OFFSET_FILL, GL_POLYGON_OFFSET_LINE, GL_POLYGON_OFFSET_POINT,
+    GL_SCISSOR_TEST, GL_STENCIL_TEST, GL_COLOR_LOGIC_OP, GL_COLOR_SUM,
+    GL_MULTISAMPLE, GL_SAMPLE_ALPHA_TO_COVERAGE, GL_DEPTH_CLAMP,
+    GL_PROGRAM_POINT_SIZE, GL_PRIMITIVE_RESTART,
+    GL_VERTEX_PROGRAM_ARB, GL_FRAGMENT_PROGRAM_ARB,
+};
+
+typedef struct {
+    uint32_t gen;
+    int val;
+} STENTRY;
+
+static struct {
+    STENTRY ent[ST_CAPS + ARRAY_SIZE(stCaps)];
+    uint32_t gen;
+    int compile;
+    uint32_t hit, miss;
+} stShadow = { .gen = 1 };
+
+static int StateCapIndex(const uint32_t cap)
+{
+    for (int i = 0; i < ARRAY_SIZE(stCaps); i++) {
+        if (stCaps[i] == cap)
+            return ST_CAPS + i;
+    }
+    return -1;
+}
+
+static int StatePackIndex(const uint32_t pname)
+{
+    switch (pname) {
+        case GL_PACK_ALIGNMENT:             return ST_PACK_ALIGNMENT;
+        case GL_PACK_ROW_LENGTH:            return ST_PACK_ROW_LENGTH;
+        case GL_PACK_SKIP_PIXELS:           return ST_PACK_SKIP_PIXELS;
+        case GL_PACK_SKIP_ROWS:             return ST_PACK_SKIP_ROWS;
+        default:
+            return -1;
+    }
+}
+
+static int StatePnameIndex(const uint32_t pname)
+{
+    switch (pname) {
+        case GL_DRAW_FRAMEBUFFER_BINDING:   return ST_DRAW_FRAMEBUFFER;
+        case GL_READ_FRAMEBUFFER_BINDING:   return ST_READ_FRAMEBUFFER;
+        case GL_CURRENT_PROGRAM:            return ST_CURRENT_PROGRAM;
+        case GL_ACTIVE_TEXTURE:             return ST_ACTIVE_TEXTURE;
+        case GL_CLIENT_ACTIVE_TEXTURE:      return ST_CLIENT_ACTIVE_TEXTURE;
+        case GL_MATRIX_MODE:                return ST_MATRIX_MODE;
+        case GL_VERTEX_ARRAY_BINDING:       return ST_VERTEX_ARRAY;
+        case GL_ARRAY_BUFFER_BINDING:       return ST_ARRAY_BUFFER;
+        case GL_PIXEL_PACK_BUFFER_BINDING:  return ST_PACK_BUFFER;
+        case GL_READ_BUFFER:                return ST_READ_BUFFER;
+        default:
+            break;
+    }
+    return (StatePackIndex(pname) >= 0)? StatePackIndex(pname):StateCapIndex(pname);
+}
+
+static int StateGet(const int idx, int *val)
+{
+    if ((idx < 0) || (stShadow.ent[idx].gen != stShadow.gen))
+        return 0;
+    *val = stShadow.ent[idx].val;
+    return 1;
+}
+
+static void StateSet(const int idx, const int val)
+{
+    if (idx < 0)
+        return;
+    /* GL_COMPILE may or may not execute the call, leave it unknown */
+    stShadow.ent[idx].gen = (stShadow.compile == GL_COMPILE)? 0:stShadow.gen;
+    stShadow.ent[idx].val = val;
+}
+
+static void StateInvalidate(const int idx)
+{
+    if (idx >= 0)
+        stShadow.ent[idx].gen = 0;
+}
+
+void MGLStateReset(void)
+{
+    stShadow.gen++;
+    stShadow.gen += (stShadow.gen)? 0:1;
+}
+
+int MGLStateFramebuffer(void)
+{
+    int val;
+
+    return (GLStateShadow() && StateGet(ST_DRAW_FRAMEBUFFER, &val))? val:-1;
+}
+
+/* Host-side reader, a miss asks the driver and keeps the answer until
+ * the next setter or reset */
+int MGLStateInt(const uint32_t pname)
+{
+    MESA_PFN(PFNGLGETINTEGERVPROC, glGetIntegerv);
+    int idx = StatePnameIndex(pname), val = 0;
+
+    if (GLStateShadow() && StateGet(idx, &val))
+        return val;
+    PFN_CALL(glGetIntegerv(pname, &val));
+    if (GLStateShadow() && !stShadow.compile)
+        StateSet(idx, val);
+    return val;
+}
+
+int MGLStateQuery(const int FEnum, const uint32_t *arg, const uintptr_t *parg, uintptr_t *ret)
+{
+    int val;
+
+    if (!GLStateShadow())
+        return 0;
+
+    switch (FEnum) {
+        case FEnum_glIsEnabled:
+            if (!StateGet(StateCapIndex(arg[0]), &val))
+                break;
+            *ret = (val)? GL_TRUE:GL_FALSE;
+            stShadow.hit++;
+            return 1;
+        case FEnum_glGetBooleanv:
+        case FEnum_glGetDoublev:
+        case FEnum_glGetFloatv:
+        case FEnum_glGetIntegerv:
+            if (!StateGet(StatePnameIndex(arg[0]), &val))
+                break;
+            if (FEnum == FEnum_glGetBooleanv)
+                *(uint8_t *)parg[1] = (val)? GL_TRUE:GL_FALSE;
+            else if (FEnum == FEnum_glGetDoublev)
+                *(double *)parg[1] = val;
+            else if (FEnum == FEnum_glGetFloatv)
+                *(float *)parg[1] = val;
+            else
+                *(int *)parg[1] = val;
+            stShadow.hit++;
+            return 1;
+        default:
+            return 0;
+    }
+    stShadow.miss++;
+    return 0;
+}
+
+void MGLStateTrack(const int FEnum, const uint32_t *arg)
+{
+    if (!GLStateShadow())
+        return;
+
+    switch (FEnum) {
+        case FEnum_glEnable:
+        case FEnum_glDisable:
+            StateSet(StateCapIndex(arg[0]), (FEnum == FEnum_glEnable));
+            break;
+        case FEnum_glEnablei:
+        case FEnum_glDisablei:
+        case FEnum_glEnableIndexedEXT:
+        case FEnum_glDisableIndexedEXT:
+            StateInvalidate(StateCapIndex(arg[0]));
+            break;
+        case FEnum_glBindFramebuffer:
+        case FEnum_glBindFramebufferEXT:
+            if (arg[0] != GL_READ_FRAMEBUFFER)
+                StateSet(ST_DRAW_FRAMEBUFFER, arg[1]);
+            if (arg[0] != GL_DRAW_FRAMEBUFFER) {
+                StateSet(ST_READ_FRAMEBUFFER, arg[1]);
+                /* read buffer is per framebuffer */
+                StateInvalidate(ST_READ_BUFFER);
+            }
+            break;
+        case FEnum_glDeleteFramebuffers:
+        case FEnum_glDeleteFramebuffersEXT:
+            StateInvalidate(ST_DRAW_FRAMEBUFFER);
+            StateInvalidate(ST_READ_FRAMEBUFFER);
+            StateInvalidate(ST_READ_BUFFER);
+            break;
+        case FEnum_glReadBuffer:
+            StateSet(ST_READ_BUFFER, arg[0]);
+            break;
+        case FEnum_glNamedFramebufferReadBuffer:
+        case FEnum_glFramebufferReadBufferEXT:
+            StateInvalidate(ST_READ_BUFFER);
+            break;
+        case FEnum_glPixelStorei:
+            StateSet(StatePackIndex(arg[0]), arg[1]);
+            break;
+        case FEnum_glPixelStoref:
+            do {
+                float f;
+                memcpy(&f, &arg[1], sizeof(float));
+                StateSet(StatePackIndex(arg[0]), (int)f);
+            } while (0);
+            break;
+        case FEnum_glUseProgram:
+            StateSet(ST_CURRENT_PROGRAM, arg[0]);
+            break;
+        case FEnum_glUseProgramObjectARB:
+            StateInvalidate(ST_CURRENT_PROGRAM);
+            break;
+        case FEnum_glActiveTexture:
+        case FEnum_glActiveTextureARB:
+            StateSet(ST_ACTIVE_TEXTURE, arg[0]);
+            break;
+        case FEnum_glClientActiveTexture:
+        case FEnum_glClientActiveTextureARB:
+            StateSet(ST_CLIENT_ACTIVE_TEXTURE, arg[0]);
+            break;
+        case FEnum_glMatrixMode:
+            StateSet(ST_MATRIX_MODE, arg[0]);
+            break;
+        case FEnum_glBindVertexArray:
+            StateSet(ST_VERTEX_ARRAY, arg[0]);
+            break;
+        case FEnum_glBindVertexArrayAPPLE:
+        case FEnum_glDeleteVertexArrays:
+        case FEnum_glDeleteVertexArraysAPPLE:
+            StateInvalidate(ST_VERTEX_ARRAY);
+            break;
+        case FEnum_glBindBuffer:
+        case FEnum_glBindBufferARB:
+            if (arg[0] == GL_ARRAY_BUFFER)
+                StateSet(ST_ARRAY_BUFFER, arg[1]);
+            if (arg[0] == GL_PIXEL_PACK_BUFFER)
+                StateSet(ST_PACK_BUFFER, arg[1]);
+            break;
+        case FEnum_glDeleteBuffers:
+        case FEnum_glDeleteBuffersARB:
+            StateInvalidate(ST_ARRAY_BUFFER);
+            StateInvalidate(ST_PACK_BUFFER);
+            break;
+        case FEnum_glNewList:
+            stShadow.compile = arg[1];
+            break;
+        case FEnum_glEndList:
+            stShadow.compile = 0;
+            break;
+        case FEnum_glCallList:
+        case FEnum_glCallLists:
+        case FEnum_glPopAttrib:
+        case FEnum_glPopClientAttrib:
+            MGLStateReset();
+            break;
+        default:
+            break;
+    }
+}
+
+void MGLStateInit(void)
+{
+    if (stShadow.hit || stShadow.miss)
+        DPRINTF("StateShadow hit %u miss %u", stShadow.hit, stShadow.miss);
+    stShadow.hit = 0;
+    stShadow.miss = 0;
+    stShadow.compile = 0;
+    MGLStateReset();
+}
@@ -0,0 +1,32 @@
+/*
+ * QEMU MESA GL Pass-Through
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _MGL_STATE_H
+#define _MGL_STATE_H
+
+void MGLStateInit(void);
+void MGLStateReset(void);
+int MGLStateQuery(const int, const uint32_t *, const uintptr_t *, uintptr_t *);
+void MGLStateTrack(const int, const uint32_t *);
+int MGLStateFramebuffer(void);
+int MGLStateInt(const uint32_t);
+
+#endif //_MGL_STATE_H
@@ -19,76 +19,219 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/queue.h"
+#include "qemu/interval-tree.h"
 
 #include "mglfuncs.h"
 #include "mglvarry.h"
 
+#define DEBUG_MGLVARRY
+
+#ifdef DEBUG_MGLVARRY
+#define DPRINTF(fmt, ...) \
+    do { fprintf(stderr, "mgl_trace: " fmt "\n" , ## __VA_ARGS__); } while(0)
+#else
+#define DPRINTF(fmt, ...)
+#endif
+
+#define VARRY_MERGE_MAX(sz) ((uint64_t)(sz) << 2)
+#define VARRY_BUDGET(sz)    ((uint64_t)(sz) << 3)
+
+/*
+ * Host copies are tied to the host binding points that were last given
+ * a pointer into them. A copy is freed only when no binding point names
+ * it, so whatever the host client-array state holds stays valid. State
+ * the device cannot follow, a non-zero VAO or glPushClientAttrib, pins
+ * the copies in use until the context goes away.
+ */
 typedef struct _vertArry {
-    uint32_t tagLo;
-    uint32_t tagHi;
+    IntervalTreeNode gva;
     uint8_t *ptr;
-    struct _vertArry *next;
+    int bound, pin, live;
+    QTAILQ_ENTRY(_vertArry) link;
 } VERTARRY, * PVERTARRY;
 
-static PVERTARRY vertexArry = NULL;
+typedef struct {
+    IntervalTreeRoot gvaRoot;
+    QTAILQ_HEAD(, _vertArry) lru, retired;
+    PVERTARRY bind[VARRY_BIND_MAX], last;
+    uint64_t bytes;
+    int cnt, pin;
+    uint32_t hit, miss, merge, evict;
+} VERTCACHE, * PVERTCACHE;
+
+static VERTCACHE vertexArry = {
+    .lru = QTAILQ_HEAD_INITIALIZER(vertexArry.lru),
+    .retired = QTAILQ_HEAD_INITIALIZER(vertexArry.retired),
+};
+
+#define ARRY_LEN(p)     ((p)->gva.last - (p)->gva.start + 1)
+
+static void FreeVertArryRegion(PVERTCACHE c, PVERTARRY p)
+{
+    if (p->live) {
+        interval_tree_remove(&p->gva, &c->gvaRoot);
+        QTAILQ_REMOVE(&c->lru, p, link);
+    }
+    else
+        QTAILQ_REMOVE(&c->retired, p, link);
+    c->last = (c->last == p)? NULL:c->last;
+    c->bytes -= ARRY_LEN(p);
+    g_free(p->ptr);
+    g_free(p);
+    c->cnt--;
+}
+
+static void RetireVertArry(PVERTCACHE c, PVERTARRY p)
+{
+    if (!p->bound && !p->pin) {
+        FreeVertArryRegion(c, p);
+        return;
+    }
+    interval_tree_remove(&p->gva, &c->gvaRoot);
+    QTAILQ_REMOVE(&c->lru, p, link);
+    QTAILQ_INSERT_TAIL(&c->retired, p, link);
+    p->live = 0;
+}
+
+static PVERTARRY FindVertArry(PVERTCACHE c, uint64_t lo, uint64_t hi)
+{
+    IntervalTreeNode *n = interval_tree_iter_first(&c->gvaRoot, lo, lo);
+
+    for (; n; n = interval_tree_iter_next(n, lo, lo)) {
+        if ((n->start <= lo) && (n->last >= hi))
+            return container_of(n, VERTARRY, gva);
+    }
+    return NULL;
+}
 
-static void *LookupVertArry(PVERTARRY *pArry, uint32_t handle, uint32_t size)
+static void *LookupVertArry(PVERTCACHE c, uint32_t handle, uint32_t size)
 {
-    PVERTARRY p = *pArry;
+    PVERTARRY p, m;
+    IntervalTreeNode *n;
+    uint64_t lo, hi;
 
     if (handle == 0)
         return NULL;
 
-    while (p) {
-        if (((handle >= p->tagLo) && (handle < p->tagHi)) &&
-            ((p->tagHi - handle) >= (size >> 1)))
-            break;
-        if (p->next == NULL)
-            break;
-        p = p->next;
+    p = FindVertArry(c, handle, (uint64_t)handle + (size >> 1) - 1);
+    if (p) {
+        c->hit++;
+        QTAILQ_REMOVE(&c->lru, p, link);
+        QTAILQ_INSERT_TAIL(&c->lru, p, link);
+        c->last = p;
+        return p->ptr + (handle - p->gva.start);
     }
-    
-    if (p == NULL) {
-        p = g_new(VERTARRY, 1);
-        p->tagLo = (handle > size)? (handle - size):PAGE_SIZE;
-        p->tagHi = p->tagLo + (size << 1);
-        p->ptr = g_malloc(size << 1);
-        p->next = NULL;
-        fprintf(stderr, " alloc vaddr %08x-%08x from hndl %08x\n", p->tagLo, p->tagHi, handle);
-        *pArry = p;
+
+    c->miss++;
+    lo = (handle > size)? (handle - size):PAGE_SIZE;
+    hi = lo + (size << 1) - 1;
+
+    /* Coalesce with overlapping or adjacent ranges up to the merge limit */
+    n = interval_tree_iter_first(&c->gvaRoot, lo - 1, hi + 1);
+    for (; n; n = interval_tree_iter_next(n, lo - 1, hi + 1)) {
+        uint64_t mlo = MIN(lo, n->start), mhi = MAX(hi, n->last);
+        if ((mhi - mlo + 1) <= VARRY_MERGE_MAX(size)) {
+            lo = mlo;
+            hi = mhi;
+        }
     }
-    else {
-        if (((handle >= p->tagLo) && (handle < p->tagHi)) && 
-            ((p->tagHi - handle) >= (size >> 1))) { }
-        else {
-            p->next = g_new(VERTARRY, 1);
-            p = p->next;
-            p->tagLo = (handle > size)? (handle - size):PAGE_SIZE;
-            p->tagHi = p->tagLo + (size << 1);
-            p->ptr = g_malloc(size << 1);
-            fprintf(stderr, " alloc vaddr %08x-%08x from hndl %08x\n", p->tagLo, p->tagHi, handle);
-            p->next = NULL;
+
+    p = g_new0(VERTARRY, 1);
+    p->gva.start = lo;
+    p->gva.last = hi;
+    p->ptr = g_malloc(ARRY_LEN(p));
+
+    n = interval_tree_iter_first(&c->gvaRoot, lo, hi);
+    while (n) {
+        IntervalTreeNode *next = interval_tree_iter_next(n, lo, hi);
+        m = container_of(n, VERTARRY, gva);
+        if ((m->gva.start >= lo) && (m->gva.last <= hi)) {
+            memcpy(p->ptr + (m->gva.start - lo), m->ptr, ARRY_LEN(m));
+            RetireVertArry(c, m);
+            c->merge++;
         }
+        n = next;
     }
 
-    return p->ptr + (handle - p->tagLo);
+    interval_tree_insert(&p->gva, &c->gvaRoot);
+    QTAILQ_INSERT_TAIL(&c->lru, p, link);
+    p->live = 1;
+    c->bytes += ARRY_LEN(p);
+    c->cnt++;
+    c->last = p;
+
+    return p->ptr + (handle - p->gva.start);
+}
+
+static void BindVertArry(PVERTCACHE c, int bind, void *ptr)
+{
+    PVERTARRY p = c->last, old;
+
+    if (ptr && p && (((uint8_t *)ptr < p->ptr) || ((uint8_t *)ptr >= (p->ptr + ARRY_LEN(p)))))
+        p = NULL;
+    if ((bind < 0) || (bind >= VARRY_BIND_MAX)) {
+        /* binding point not followed, keep the copy for good */
+        if (ptr && p)
+            p->pin = 1;
+        return;
+    }
+    old = c->bind[bind];
+    c->bind[bind] = (ptr)? p:NULL;
+    if (c->bind[bind]) {
+        c->bind[bind]->bound++;
+        c->bind[bind]->pin |= c->pin;
+    }
+    if (old && !--old->bound && !old->pin && !old->live)
+        FreeVertArryRegion(c, old);
 }
 
-static int FreeVertArry(PVERTARRY *pArry)
+static void PinVertArry(PVERTCACHE c, int pin)
 {
-    PVERTARRY p = *pArry;
-    int cnt = 0;
-    while (p) {
-        PVERTARRY next = p->next;
-        g_free(p->ptr);
-        g_free(p);
-        p = next;
-        cnt++;
+    if (pin && !c->pin) {
+        for (int i = 0; i < VARRY_BIND_MAX; i++) {
+            if (c->bind[i])
+                c->bind[i]->pin = 1;
+        }
     }
-    *pArry = p;
+    c->pin = pin;
+}
+
+static void TrimVertArry(PVERTCACHE c, uint32_t size)
+{
+    PVERTARRY p, next;
+
+    QTAILQ_FOREACH_SAFE(p, &c->lru, link, next) {
+        if (c->bytes <= VARRY_BUDGET(size))
+            break;
+        if (!p->bound && !p->pin) {
+            FreeVertArryRegion(c, p);
+            c->evict++;
+        }
+    }
+}
+
+static int FreeVertArry(PVERTCACHE c)
+{
+    PVERTARRY p;
+    int cnt = c->cnt;
+
+    if (c->hit || c->miss)
+        DPRINTF("  vertex cache hit %u miss %u merge %u evict %u",
+            c->hit, c->miss, c->merge, c->evict);
+    while ((p = QTAILQ_FIRST(&c->lru)))
+        FreeVertArryRegion(c, p);
+    while ((p = QTAILQ_FIRST(&c->retired)))
+        FreeVertArryRegion(c, p);
+    memset(c->bind, 0, sizeof(c->bind));
+    c->last = NULL;
+    c->pin = 0;
+    c->hit = c->miss = c->merge = c->evict = 0;
     return cnt;
 }
 
 void *LookupVertex(uint32_t handle, uint32_t size) { return LookupVertArry(&vertexArry, handle, size); }
+void BindVertex(int bind, void *ptr) { BindVertArry(&vertexArry, bind, ptr); }
+void PinVertex(int pin) { PinVertArry(&vertexArry, pin); }
+void TrimVertex(uint32_t size) { TrimVertArry(&vertexArry, size); }
 int FreeVertex(void) { return FreeVertArry(&vertexArry); }
-
@@ -21,7 +21,12 @@
 #ifndef _MGL_VERTARRY_H
 #define _MGL_VERTARRY_H
 
+#define VARRY_BIND_MAX 48
+
 void *LookupVertex(uint32_t, uint32_t);
+void BindVertex(int, void *);
+void PinVertex(int);
+void TrimVertex(uint32_t);
 int FreeVertex(void);
 
 #endif //_MGL_VERTARRY_H
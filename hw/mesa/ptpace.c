@@ -0,0 +1,163 @@
+/*
+ * QEMU 3Dfx Glide/MESA GL Pass-Through frame pacing
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "qemu/osdep.h"
+#include "qemu/main-loop.h"
+#include "qemu/timer.h"
+#include "ui/console.h"
+#include "hw/ptpace.h"
+
+#define DEBUG_PTPACE
+
+#ifdef DEBUG_PTPACE
+#define DPRINTF(fmt, ...) \
+    do { fprintf(stderr, "ptpace: " fmt "\n" , ## __VA_ARGS__); } while(0)
+#else
+#define DPRINTF(fmt, ...)
+#endif
+
+/* waits shorter than this are not worth a sleep */
+#define PTPACE_MIN_WAIT     (200 * SCALE_US)
+/* head room kept ahead of the predicted frame in adaptive mode */
+#define PTPACE_MARGIN       (1 * SCALE_MS)
+/* EWMA weight 1/8 */
+#define PTPACE_EWMA(avg, ns) ((avg) += ((ns) - (avg)) / 8)
+
+struct PTPace {
+    const char *name;
+    int mode, fps;
+    int64_t next, present, release, hold;
+    int64_t work, cost;
+    uint64_t frames, missed, waits;
+};
+
+static int64_t ptpace_period(PTPace *p)
+{
+    QemuConsole *con;
+    const QemuUIInfo *info;
+
+    if (p->fps)
+        return NANOSECONDS_PER_SECOND / p->fps;
+    con = qemu_console_lookup_by_index(0);
+    info = (con && dpy_ui_info_supported(con))? dpy_get_ui_info(con):0;
+    if (info && info->refresh_rate)
+        return (NANOSECONDS_PER_SECOND * 1000) / info->refresh_rate;
+    return NANOSECONDS_PER_SECOND / 60;
+}
+
+static void ptpace_wait(PTPace *p, int64_t deadline)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+
+    if ((deadline - now) < PTPACE_MIN_WAIT)
+        return;
+    g_usleep((deadline - now) / SCALE_US);
+    p->waits++;
+}
+
+static void ptpace_advance(PTPace *p, int64_t now)
+{
+    int64_t period = ptpace_period(p);
+
+    if (!p->next || ((now - p->next) > (period << 3))) {
+        p->next = now + period;
+        return;
+    }
+    p->next += period;
+    if (p->next <= now) {
+        int64_t skip = ((now - p->next) / period) + 1;
+        p->next += skip * period;
+        p->missed += skip;
+    }
+}
+
+PTPace *ptpace_new(const char *name)
+{
+    PTPace *p = g_new0(PTPace, 1);
+
+    p->name = name;
+    return p;
+}
+
+void ptpace_config(PTPace *p, int mode, int fps)
+{
+    if (p->frames)
+        DPRINTF("%s %" PRIu64 " frames %" PRIu64 " missed %" PRIu64 " waits, work %.2f ms present %.2f ms",
+            p->name, p->frames, p->missed, p->waits, p->work / 1e6, p->cost / 1e6);
+    p->mode = mode;
+    p->fps = fps;
+    p->next = 0;
+    p->release = 0;
+    p->hold = 0;
+    p->work = 0;
+    p->cost = 0;
+    p->frames = 0;
+    p->missed = 0;
+    p->waits = 0;
+    if (p->mode)
+        DPRINTF("%s %s pacing, %.2f ms period%s", p->name,
+            (p->mode == PTPACE_ADAPTIVE)? "adaptive":"fixed", ptpace_period(p) / 1e6,
+            (p->fps)? "":" from display refresh");
+}
+
+int ptpace_active(PTPace *p)
+{
+    return (p && p->mode)? 1:0;
+}
+
+void ptpace_swap_begin(PTPace *p)
+{
+    int64_t now;
+
+    if (!ptpace_active(p))
+        return;
+    now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    if (p->release)
+        PTPACE_EWMA(p->work, now - p->release);
+    p->present = now;
+}
+
+void ptpace_swap_end(PTPace *p)
+{
+    int64_t now;
+
+    if (!ptpace_active(p))
+        return;
+    now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    PTPACE_EWMA(p->cost, now - p->present);
+    ptpace_advance(p, now);
+    p->hold = (p->mode == PTPACE_ADAPTIVE)?
+        (p->next - p->work - p->cost - PTPACE_MARGIN):p->next;
+    p->release = now;
+    p->frames++;
+}
+
+void ptpace_hold(PTPace *p)
+{
+    if (!ptpace_active(p) || !p->hold)
+        return;
+    /* never sleep in an MMIO handler or the main loop */
+    if (qemu_mutex_iothread_locked())
+        return;
+    ptpace_wait(p, p->hold);
+    p->hold = 0;
+    p->release = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+}
@@ -0,0 +1,301 @@
+/*
+ * QEMU 3Dfx Glide/MESA GL Pass-Through FIFO trace
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qemu/cutils.h"
+#include "qemu/main-loop.h"
+#include "qemu/timer.h"
+#include "sysemu/runstate.h"
+#include "sysemu/sysemu.h"
+#include "hw/pttrace.h"
+
+#define DEBUG_PTTRACE
+
+#ifdef DEBUG_PTTRACE
+#define DPRINTF(fmt, ...) \
+    do { fprintf(stderr, "pttrace: " fmt "\n" , ## __VA_ARGS__); } while(0)
+#else
+#define DPRINTF(fmt, ...)
+#endif
+
+/* doorbells replayed per main loop iteration */
+#define PTTRACE_REPLAY_BATCH 64
+/* poll interval and give-up time for a recorded register read */
+#define PTTRACE_READ_POLL   1
+#define PTTRACE_READ_LIMIT  (10 * NANOSECONDS_PER_SECOND)
+
+struct PTTrace {
+    FILE *fp;
+    GMappedFile *map;
+    const uint8_t *pos, *end;
+    MemoryRegion *mr[PTTRACE_MAX_REGION];
+    int nregions;
+    int primed;
+    const PTTraceOps *ops;
+    void *opaque;
+    QEMUBH *bh;
+    QEMUTimer *poll;
+    Notifier exit;
+    hwaddr rdAddr;
+    uint64_t rdVal;
+    int rdLast;
+    uint64_t doorbells, pages, reads;
+    int64_t start, wait;
+};
+
+static void pttrace_write(PTTrace *t, int type, int arg, hwaddr addr, uint64_t val,
+                          const void *data, uint32_t len)
+{
+    static const uint8_t pad[8];
+    PTTraceRecord rec = {
+        .type = type, .arg = arg, .len = len, .addr = addr, .val = val
+    };
+
+    fwrite(&rec, sizeof(rec), 1, t->fp);
+    if (len) {
+        fwrite(data, len, 1, t->fp);
+        fwrite(pad, ROUND_UP(len, 8) - len, 1, t->fp);
+    }
+}
+
+static void pttrace_pages(PTTrace *t)
+{
+    for (int i = 0; i < t->nregions; i++) {
+        MemoryRegion *mr = t->mr[i];
+        uint8_t *ptr = memory_region_get_ram_ptr(mr);
+        hwaddr size = memory_region_size(mr), run = 0, cnt = 0;
+        DirtyBitmapSnapshot *snap =
+            memory_region_snapshot_and_clear_dirty(mr, 0, size, DIRTY_MEMORY_VGA);
+
+        for (hwaddr offs = 0; offs <= size; offs += PTTRACE_PAGE) {
+            /* all pages start dirty, only keep the ones with content once */
+            int dirty = (offs < size) &&
+                memory_region_snapshot_get_dirty(mr, snap, offs, PTTRACE_PAGE) &&
+                (t->primed || !buffer_is_zero(ptr + offs, PTTRACE_PAGE));
+            if (dirty) {
+                run = (cnt)? run:offs;
+                cnt += PTTRACE_PAGE;
+            }
+            else if (cnt) {
+                pttrace_write(t, PTTRACE_REC_PAGE, i, run, 0, ptr + run, cnt);
+                t->pages += cnt / PTTRACE_PAGE;
+                cnt = 0;
+            }
+        }
+        g_free(snap);
+    }
+    t->primed = 1;
+}
+
+void pttrace_doorbell(PTTrace *t, hwaddr addr, uint64_t val)
+{
+    pttrace_pages(t);
+    pttrace_write(t, PTTRACE_REC_DOORBELL, 0, addr, val, 0, 0);
+    t->doorbells++;
+    t->rdLast = 0;
+}
+
+void pttrace_read(PTTrace *t, hwaddr addr, uint64_t val)
+{
+    /* a polled register is kept once per value between doorbells */
+    if (t->rdLast && (t->rdAddr == addr) && (t->rdVal == val))
+        return;
+    pttrace_write(t, PTTRACE_REC_READ, 0, addr, val, 0, 0);
+    t->rdAddr = addr;
+    t->rdVal = val;
+    t->rdLast = 1;
+    t->reads++;
+}
+
+void pttrace_mmio(PTTrace *t, hwaddr addr, uint64_t val, unsigned size)
+{
+    pttrace_write(t, PTTRACE_REC_MMIO, size, addr, val, 0, 0);
+}
+
+static void pttrace_record_exit(Notifier *n, void *data)
+{
+    PTTrace *t = container_of(n, PTTrace, exit);
+
+    pttrace_write(t, PTTRACE_REC_END, 0, 0, 0, 0, 0);
+    fclose(t->fp);
+    DPRINTF("recorded %" PRIu64 " doorbells %" PRIu64 " reads %" PRIu64 " pages",
+        t->doorbells, t->reads, t->pages);
+}
+
+PTTrace *pttrace_record(const char *path, uint32_t device,
+                        MemoryRegion **mr, int nregions, Error **errp)
+{
+    PTTraceHeader hdr = { .version = PTTRACE_VERSION, .device = device,
+        .page_size = PTTRACE_PAGE, .nregions = nregions };
+    PTTrace *t;
+    FILE *fp;
+
+    assert(nregions <= PTTRACE_MAX_REGION);
+    fp = fopen(path, "wb");
+    if (!fp) {
+        error_setg_errno(errp, errno, "pttrace: cannot create '%s'", path);
+        return NULL;
+    }
+    memcpy(hdr.magic, PTTRACE_MAGIC, sizeof(hdr.magic));
+    t = g_new0(PTTrace, 1);
+    t->fp = fp;
+    t->nregions = nregions;
+    for (int i = 0; i < nregions; i++) {
+        t->mr[i] = mr[i];
+        hdr.region_size[i] = memory_region_size(mr[i]);
+        memory_region_set_log(mr[i], true, DIRTY_MEMORY_VGA);
+    }
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+    t->exit.notify = pttrace_record_exit;
+    qemu_add_exit_notifier(&t->exit);
+    DPRINTF("recording to %s", path);
+
+    return t;
+}
+
+static void pttrace_replay_done(PTTrace *t, const char *why)
+{
+    double secs = (get_clock() - t->start) / 1e9;
+
+    DPRINTF("replay %s, %" PRIu64 " doorbells %" PRIu64 " reads %" PRIu64 " pages in %.3f s (%.1f doorbells/s)",
+        why, t->doorbells, t->reads, t->pages, secs, (secs > 0)? (t->doorbells / secs):0);
+    qemu_bh_delete(t->bh);
+    t->bh = 0;
+    timer_free(t->poll);
+    t->poll = 0;
+    g_mapped_file_unref(t->map);
+    t->map = 0;
+    qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_UI);
+}
+
+static void pttrace_replay_bh(void *opaque)
+{
+    PTTrace *t = opaque;
+    int n = 0;
+
+    if (!t->start)
+        t->start = get_clock();
+
+    while (n < PTTRACE_REPLAY_BATCH) {
+        const PTTraceRecord *rec = (const PTTraceRecord *)t->pos;
+        const uint8_t *payload = t->pos + sizeof(PTTraceRecord);
+
+        if (((t->end - t->pos) < sizeof(PTTraceRecord)) || ((t->end - payload) < rec->len)) {
+            pttrace_replay_done(t, "truncated");
+            return;
+        }
+        switch (rec->type) {
+            case PTTRACE_REC_PAGE:
+                if ((rec->arg >= t->nregions) ||
+                    ((rec->addr + rec->len) > memory_region_size(t->mr[rec->arg]))) {
+                    pttrace_replay_done(t, "out of bounds");
+                    return;
+                }
+                memcpy((uint8_t *)memory_region_get_ram_ptr(t->mr[rec->arg]) + rec->addr,
+                    payload, rec->len);
+                t->pages += rec->len / PTTRACE_PAGE;
+                break;
+            case PTTRACE_REC_DOORBELL:
+                t->ops->doorbell(t->opaque, rec->addr, rec->val);
+                t->doorbells++;
+                n++;
+                break;
+            case PTTRACE_REC_READ:
+                /*
+                 * The guest polled this register until it saw the value,
+                 * e.g. the window status that binds the context once the
+                 * window is up. Keep polling before the next doorbell.
+                 */
+                if (t->ops->read && (t->ops->read(t->opaque, rec->addr) != rec->val)) {
+                    t->wait = (t->wait)? t->wait:get_clock();
+                    if ((get_clock() - t->wait) > PTTRACE_READ_LIMIT) {
+                        pttrace_replay_done(t, "read timeout");
+                        return;
+                    }
+                    timer_mod(t->poll, qemu_clock_get_ms(QEMU_CLOCK_REALTIME) + PTTRACE_READ_POLL);
+                    return;
+                }
+                t->wait = 0;
+                t->reads++;
+                break;
+            case PTTRACE_REC_MMIO:
+                if (t->ops->mmio)
+                    t->ops->mmio(t->opaque, rec->addr, rec->val, rec->arg);
+                break;
+            case PTTRACE_REC_END:
+                pttrace_replay_done(t, "complete");
+                return;
+            default:
+                pttrace_replay_done(t, "bad record");
+                return;
+        }
+        t->pos = payload + ROUND_UP(rec->len, 8);
+    }
+    qemu_bh_schedule(t->bh);
+}
+
+PTTrace *pttrace_replay(const char *path, uint32_t device,
+                        MemoryRegion **mr, int nregions,
+                        const PTTraceOps *ops, void *opaque, Error **errp)
+{
+    g_autoptr(GError) gerr = NULL;
+    const PTTraceHeader *hdr;
+    GMappedFile *map;
+    PTTrace *t;
+
+    map = g_mapped_file_new(path, FALSE, &gerr);
+    if (!map) {
+        error_setg(errp, "pttrace: cannot map '%s': %s", path, gerr->message);
+        return NULL;
+    }
+    hdr = (const PTTraceHeader *)g_mapped_file_get_contents(map);
+    if ((g_mapped_file_get_length(map) < sizeof(PTTraceHeader)) ||
+        memcmp(hdr->magic, PTTRACE_MAGIC, sizeof(hdr->magic)) ||
+        (hdr->version != PTTRACE_VERSION) || (hdr->device != device) ||
+        (hdr->page_size != PTTRACE_PAGE) || (hdr->nregions != nregions)) {
+        error_setg(errp, "pttrace: '%s' is not a version %d trace for this device",
+            path, PTTRACE_VERSION);
+        g_mapped_file_unref(map);
+        return NULL;
+    }
+    for (int i = 0; i < nregions; i++) {
+        if (hdr->region_size[i] != memory_region_size(mr[i])) {
+            error_setg(errp, "pttrace: '%s' region %d size mismatch", path, i);
+            g_mapped_file_unref(map);
+            return NULL;
+        }
+    }
+    t = g_new0(PTTrace, 1);
+    t->map = map;
+    t->pos = (const uint8_t *)&hdr[1];
+    t->end = (const uint8_t *)hdr + g_mapped_file_get_length(map);
+    t->nregions = nregions;
+    for (int i = 0; i < nregions; i++)
+        t->mr[i] = mr[i];
+    t->ops = ops;
+    t->opaque = opaque;
+    t->bh = qemu_bh_new(pttrace_replay_bh, t);
+    t->poll = timer_new_ms(QEMU_CLOCK_REALTIME, pttrace_replay_bh, t);
+    qemu_bh_schedule(t->bh);
+    DPRINTF("replaying %s", path);
+
+    return t;
+}
@@ -0,0 +1,53 @@
+/*
+ * QEMU 3Dfx Glide/MESA GL Pass-Through frame pacing
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HW_PTPACE_H
+#define HW_PTPACE_H
+
+/*
+ * Host-side frame pacing for the pass-through swap doorbells.
+ *
+ * Swaps are placed on a deadline grid at the FpsLimit rate, or at the
+ * refresh rate reported by the UI for console 0 when no limit is set.
+ * The MMIO handler only records the swap; the wait is taken by the
+ * render/dispatch worker in ptpace_hold() before it picks up the first
+ * job of the next frame, so the BQL is never released mid-swap. Without
+ * a worker thread pacing stays off and the guest wrapper limits the
+ * frame rate from the FpsLimit returned on swap.
+ *
+ *   PTPACE_FIXED      start each frame on the next grid deadline
+ *   PTPACE_ADAPTIVE   start the next frame just in time to present on its
+ *                     deadline from the predicted guest work and present
+ *                     cost
+ */
+#define PTPACE_OFF          0
+#define PTPACE_FIXED        1
+#define PTPACE_ADAPTIVE     2
+
+typedef struct PTPace PTPace;
+
+PTPace *ptpace_new(const char *name);
+void ptpace_config(PTPace *p, int mode, int fps);
+int ptpace_active(PTPace *p);
+void ptpace_swap_begin(PTPace *p);
+void ptpace_swap_end(PTPace *p);
+void ptpace_hold(PTPace *p);
+
+#endif /* HW_PTPACE_H */
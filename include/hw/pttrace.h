@@ -0,0 +1,88 @@
+/*
+ * QEMU 3Dfx Glide/MESA GL Pass-Through FIFO trace
+ *
+ *  Copyright (c) 2020
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library;
+ * if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HW_PTTRACE_H
+#define HW_PTTRACE_H
+
+#include "exec/memory.h"
+
+/*
+ * Trace file layout, host endian, every record 8-byte aligned so that
+ * a trace can be replayed straight out of a read-only mapping:
+ *
+ *   PTTraceHeader
+ *   { PTTraceRecord [payload, padded to 8 bytes] } ...
+ *   PTTraceRecord { .type = PTTRACE_REC_END }
+ *
+ * Guest writes to the shared windows are captured as runs of dirty
+ * pages ahead of the doorbell that consumes them, so a replay only
+ * has to restore the pages and ring the same doorbells. Polled status
+ * reads are kept once per value, and the replay waits for each to read
+ * back the same before it rings the next doorbell.
+ */
+#define PTTRACE_MAGIC       "QPTTRACE"
+#define PTTRACE_VERSION     2
+#define PTTRACE_PAGE        4096
+#define PTTRACE_MAX_REGION  4
+
+#define PTTRACE_DEV_MESA    1
+#define PTTRACE_DEV_GLIDE   2
+
+#define PTTRACE_REC_END     0
+#define PTTRACE_REC_PAGE    1   /* arg: region, addr: offset, payload: pages */
+#define PTTRACE_REC_DOORBELL 2  /* addr, val: device register write */
+#define PTTRACE_REC_MMIO    3   /* arg: size, addr, val: LFB aperture write */
+#define PTTRACE_REC_READ    4   /* addr, val: device register read result */
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t device;
+    uint32_t page_size;
+    uint32_t nregions;
+    uint64_t region_size[PTTRACE_MAX_REGION];
+} PTTraceHeader;
+
+typedef struct {
+    uint16_t type;
+    uint16_t arg;
+    uint32_t len;
+    uint64_t addr;
+    uint64_t val;
+} PTTraceRecord;
+
+typedef struct {
+    void (*doorbell)(void *opaque, hwaddr addr, uint64_t val);
+    void (*mmio)(void *opaque, hwaddr addr, uint64_t val, unsigned size);
+    uint64_t (*read)(void *opaque, hwaddr addr);
+} PTTraceOps;
+
+typedef struct PTTrace PTTrace;
+
+PTTrace *pttrace_record(const char *path, uint32_t device,
+                        MemoryRegion **mr, int nregions, Error **errp);
+void pttrace_doorbell(PTTrace *t, hwaddr addr, uint64_t val);
+void pttrace_mmio(PTTrace *t, hwaddr addr, uint64_t val, unsigned size);
+void pttrace_read(PTTrace *t, hwaddr addr, uint64_t val);
+PTTrace *pttrace_replay(const char *path, uint32_t device,
+                        MemoryRegion **mr, int nregions,
+                        const PTTraceOps *ops, void *opaque, Error **errp);
+
+#endif /* HW_PTTRACE_H */